@@ -0,0 +1,79 @@
+#include "async_search.h"
+
+#include <algorithm>
+
+using namespace std::string_literals;
+
+void AsyncQueryOptions::ThrowIfCancelled() const {
+    if (stop_token.stop_requested()) {
+        throw QueryCancelled("Запрос отменён"s);
+    }
+    if (Clock::now() >= deadline) {
+        throw QueryCancelled("Истёк срок выполнения запроса"s);
+    }
+}
+
+QueryExecutor::QueryExecutor(size_t thread_count) {
+    thread_count = std::max<size_t>(thread_count, 1);
+    threads_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads_.emplace_back([this] { Run(); });
+    }
+}
+
+QueryExecutor::~QueryExecutor() {
+    {
+        std::lock_guard guard(mutex_);
+        stopping_ = true;
+    }
+    has_work_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+    // Потоки ушли, не разобрав очередь. Корутины из неё возобновляются здесь и бросают QueryCancelled:
+    // так их кадры освобождают владельцы, а SyncWait получает ошибку вместо вечного ожидания
+    while (!ready_.empty()) {
+        const auto handle = ready_.front();
+        ready_.pop_front();
+        handle.resume();
+    }
+}
+
+QueryExecutor::ScheduleAwaiter QueryExecutor::Schedule() noexcept {
+    return { *this };
+}
+
+bool QueryExecutor::Enqueue(std::coroutine_handle<> handle) {
+    {
+        std::lock_guard guard(mutex_);
+        if (stopping_) {
+            return false;
+        }
+        ready_.push_back(handle);
+    }
+    has_work_.notify_one();
+    return true;
+}
+
+void QueryExecutor::ThrowIfStopped() {
+    std::lock_guard guard(mutex_);
+    if (stopping_) {
+        throw QueryCancelled("Пул запросов остановлен"s);
+    }
+}
+
+void QueryExecutor::Run() {
+    while (true) {
+        std::coroutine_handle<> handle;
+        {
+            std::unique_lock lock(mutex_);
+            has_work_.wait(lock, [this] { return stopping_ || !ready_.empty(); });
+            if (stopping_) {
+                return;
+            }
+            handle = ready_.front();
+            ready_.pop_front();
+        }
+        handle.resume();
+    }
+}
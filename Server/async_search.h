@@ -0,0 +1,213 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class QueryCancelled : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+struct AsyncQueryOptions {
+    using Clock = std::chrono::steady_clock;
+
+    std::stop_token stop_token;
+    Clock::time_point deadline = Clock::time_point::max();
+
+    void ThrowIfCancelled() const;
+};
+
+// Пул потоков, на котором возобновляются корутины запросов. Один поток обслуживает
+// много запросов: длинный запрос уступает его между блоками постингов.
+// При разрушении пула ждущие в очереди корутины завершаются с QueryCancelled
+class QueryExecutor {
+public:
+    explicit QueryExecutor(size_t thread_count = std::thread::hardware_concurrency());
+
+    QueryExecutor(const QueryExecutor&) = delete;
+    QueryExecutor& operator=(const QueryExecutor&) = delete;
+
+    ~QueryExecutor();
+
+    struct ScheduleAwaiter {
+        QueryExecutor& executor;
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        // Остановленный пул корутину не принимает: она продолжается сразу и получает QueryCancelled
+        bool await_suspend(std::coroutine_handle<> handle) {
+            return executor.Enqueue(handle);
+        }
+
+        void await_resume() const {
+            executor.ThrowIfStopped();
+        }
+    };
+
+    // Ставит корутину в конец очереди пула: первый вызов уводит её с потока вызывающего,
+    // следующие пропускают вперёд остальные запросы
+    ScheduleAwaiter Schedule() noexcept;
+
+private:
+    std::mutex mutex_;
+    std::condition_variable has_work_;
+    std::deque<std::coroutine_handle<>> ready_;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+
+    bool Enqueue(std::coroutine_handle<> handle);
+
+    void ThrowIfStopped();
+
+    void Run();
+};
+
+// Ленивая задача: начинает выполняться, когда её ждут через co_await
+template <typename T>
+class SearchTask {
+public:
+    struct promise_type {
+        std::optional<T> value;
+        std::exception_ptr error;
+        std::coroutine_handle<> continuation;
+
+        SearchTask get_return_object() {
+            return SearchTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        struct FinalAwaiter {
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+                const auto continuation = handle.promise().continuation;
+                return continuation ? continuation : std::noop_coroutine();
+            }
+
+            void await_resume() const noexcept {
+            }
+        };
+
+        FinalAwaiter final_suspend() noexcept {
+            return {};
+        }
+
+        void return_value(T result) {
+            value = std::move(result);
+        }
+
+        void unhandled_exception() {
+            error = std::current_exception();
+        }
+    };
+
+    SearchTask(SearchTask&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+
+    SearchTask& operator=(SearchTask&& other) noexcept {
+        if (this != &other) {
+            Destroy();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+
+    SearchTask(const SearchTask&) = delete;
+    SearchTask& operator=(const SearchTask&) = delete;
+
+    ~SearchTask() {
+        Destroy();
+    }
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle_.promise().continuation = awaiting;
+        return handle_;
+    }
+
+    T await_resume() {
+        auto& promise = handle_.promise();
+        if (promise.error) {
+            std::rethrow_exception(promise.error);
+        }
+        return std::move(*promise.value);
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle_;
+
+    explicit SearchTask(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+    void Destroy() {
+        if (handle_) {
+            handle_.destroy();
+            handle_ = {};
+        }
+    }
+};
+
+namespace AsyncSearchPrivate {
+
+    struct DetachedTask {
+        struct promise_type {
+            DetachedTask get_return_object() noexcept {
+                return {};
+            }
+
+            std::suspend_never initial_suspend() noexcept {
+                return {};
+            }
+
+            std::suspend_never final_suspend() noexcept {
+                return {};
+            }
+
+            void return_void() noexcept {
+            }
+
+            void unhandled_exception() noexcept {
+                std::terminate();
+            }
+        };
+    };
+
+    template <typename T>
+    DetachedTask Complete(SearchTask<T>& task, std::promise<T> result) {
+        try {
+            result.set_value(co_await task);
+        }
+        catch (...) {
+            result.set_exception(std::current_exception());
+        }
+    }
+
+}  // namespace AsyncSearchPrivate
+
+// Блокирующее ожидание задачи для кода вне корутин
+template <typename T>
+T SyncWait(SearchTask<T> task) {
+    std::promise<T> result;
+    auto future = result.get_future();
+    AsyncSearchPrivate::Complete(task, std::move(result));
+    return future.get();
+}
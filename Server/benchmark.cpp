@@ -0,0 +1,247 @@
+#include "benchmark.h"
+
+#include <cmath>
+#include <execution>
+#include <optional>
+#include <set>
+#include <sstream>
+
+#include "process_queries.h"
+#include "remove_duplicates.h"
+#include "search_server.h"
+
+namespace {
+
+// Результаты операций складываются сюда, чтобы компилятор не выбросил сами операции
+volatile size_t benchmark_sink = 0;
+
+std::string GenerateWord(std::mt19937& generator, int max_length) {
+    const int length = std::uniform_int_distribution(1, max_length)(generator);
+    std::string word;
+    word.reserve(length);
+    for (int i = 0; i < length; ++i) {
+        word.push_back(static_cast<char>(std::uniform_int_distribution<int>('a', 'z')(generator)));
+    }
+    return word;
+}
+
+std::vector<std::string> GenerateDictionary(std::mt19937& generator, size_t word_count, int max_length) {
+    std::set<std::string> unique_words;
+    // Короткие слова кончаются быстро, поэтому число попыток ограничено
+    for (size_t attempt = 0; unique_words.size() < word_count && attempt < word_count * 100; ++attempt) {
+        unique_words.insert(GenerateWord(generator, max_length));
+    }
+    std::vector<std::string> words(unique_words.begin(), unique_words.end());
+    std::shuffle(words.begin(), words.end(), generator);
+    return words;
+}
+
+void FillServer(SearchServer& search_server, const Corpus& corpus) {
+    for (size_t i = 0; i < corpus.documents.size(); ++i) {
+        search_server.AddDocument(static_cast<int>(i), corpus.documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+    }
+}
+
+double GetMedian(std::vector<double> values) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    const size_t middle = values.size() / 2;
+    return values.size() % 2 == 1 ? values[middle] : (values[middle - 1] + values[middle]) / 2.0;
+}
+
+void PrintJsonString(std::ostream& out, std::string_view text) {
+    out << '"';
+    for (const char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\';
+        }
+        out << c;
+    }
+    out << '"';
+}
+
+}  // namespace
+
+ZipfDistribution::ZipfDistribution(size_t size, double exponent) {
+    if (size == 0) {
+        throw std::invalid_argument("Распределение Ципфа задаётся хотя бы на одном значении"s);
+    }
+    cumulative_weights_.reserve(size);
+    double total = 0.0;
+    for (size_t rank = 1; rank <= size; ++rank) {
+        total += 1.0 / std::pow(static_cast<double>(rank), exponent);
+        cumulative_weights_.push_back(total);
+    }
+}
+
+size_t ZipfDistribution::operator()(std::mt19937& generator) const {
+    const double point = std::uniform_real_distribution<>(0.0, cumulative_weights_.back())(generator);
+    const auto rank = std::upper_bound(cumulative_weights_.begin(), cumulative_weights_.end(), point);
+    return std::min(static_cast<size_t>(rank - cumulative_weights_.begin()), cumulative_weights_.size() - 1);
+}
+
+Corpus GenerateCorpus(const CorpusOptions& options) {
+    if (options.dictionary_size == 0) {
+        throw std::invalid_argument("Словарь корпуса должен быть непустым"s);
+    }
+    if (options.min_document_length < 1 || options.min_document_length > options.max_document_length
+        || options.min_query_length < 1 || options.min_query_length > options.max_query_length) {
+        throw std::invalid_argument("Некорректные границы длины документов или запросов"s);
+    }
+    std::mt19937 generator(options.seed);
+    Corpus corpus;
+    corpus.dictionary = GenerateDictionary(generator, options.dictionary_size, options.max_word_length);
+    const ZipfDistribution word_rank(corpus.dictionary.size(), options.zipf_exponent);
+    std::bernoulli_distribution is_duplicate(options.duplicate_ratio);
+    std::bernoulli_distribution is_minus(options.minus_word_ratio);
+
+    corpus.documents.reserve(options.document_count);
+    for (size_t i = 0; i < options.document_count; ++i) {
+        if (i > 0 && is_duplicate(generator)) {
+            // Те же слова в другом порядке
+            const auto& original = corpus.documents[std::uniform_int_distribution<size_t>(0, i - 1)(generator)];
+            auto words = SplitIntoWords(original);
+            std::shuffle(words.begin(), words.end(), generator);
+            std::string document;
+            for (const auto& word : words) {
+                document += document.empty() ? word : " "s + word;
+            }
+            corpus.documents.push_back(std::move(document));
+            continue;
+        }
+        const int length = std::uniform_int_distribution(options.min_document_length, options.max_document_length)(generator);
+        std::string document;
+        for (int j = 0; j < length; ++j) {
+            if (!document.empty()) {
+                document.push_back(' ');
+            }
+            document += corpus.dictionary[word_rank(generator)];
+        }
+        corpus.documents.push_back(std::move(document));
+    }
+
+    corpus.queries.reserve(options.query_count);
+    for (size_t i = 0; i < options.query_count; ++i) {
+        const int length = std::uniform_int_distribution(options.min_query_length, options.max_query_length)(generator);
+        std::string query;
+        for (int j = 0; j < length; ++j) {
+            if (!query.empty()) {
+                query.push_back(' ');
+            }
+            if (is_minus(generator)) {
+                query.push_back('-');
+            }
+            query += corpus.dictionary[word_rank(generator)];
+        }
+        corpus.queries.push_back(std::move(query));
+    }
+    return corpus;
+}
+
+uint64_t BenchmarkResult::GetOperationPercentile(double percentile) const {
+    if (operation_nanoseconds.empty()) {
+        return 0;
+    }
+    const auto rank = static_cast<size_t>(std::ceil(percentile / 100.0 * operation_nanoseconds.size()));
+    return operation_nanoseconds[std::clamp<size_t>(rank, 1, operation_nanoseconds.size()) - 1];
+}
+
+std::vector<BenchmarkResult> RunSearchServerBenchmarks(const Corpus& corpus, size_t repetitions) {
+    std::vector<BenchmarkResult> results;
+    const std::string& stop_word = corpus.dictionary.front();
+    const size_t document_count = corpus.documents.size();
+    const size_t query_count = corpus.queries.size();
+    std::optional<SearchServer> search_server;
+    const auto build_empty = [&] { search_server.emplace(stop_word); };
+    const auto build_full = [&] {
+        search_server.emplace(stop_word);
+        FillServer(*search_server, corpus);
+    };
+
+    results.push_back(RunBenchmark("AddDocument"s, repetitions, document_count, build_empty, [&](size_t i) {
+        search_server->AddDocument(static_cast<int>(i), corpus.documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+        }));
+    results.push_back(RunBenchmark("RemoveDocument"s, repetitions, document_count, build_full, [&](size_t i) {
+        search_server->RemoveDocument(static_cast<int>(i));
+        }));
+
+    build_full();
+    const auto no_preparation = [] {};
+    // Запросы сопоставляются с документами корпуса, поэтому в пустом корпусе сопоставлять не с чем
+    if (document_count > 0) {
+        results.push_back(RunBenchmark("MatchDocument"s, repetitions, query_count, no_preparation, [&](size_t i) {
+            const int document_id = static_cast<int>(i * 7919 % document_count);
+            benchmark_sink = benchmark_sink + std::get<0>(search_server->MatchDocument(corpus.queries[i], document_id)).size();
+            }));
+    }
+    results.push_back(RunBenchmark("FindTopDocuments/seq"s, repetitions, query_count, no_preparation, [&](size_t i) {
+        benchmark_sink = benchmark_sink + search_server->FindTopDocuments(std::execution::seq, corpus.queries[i]).size();
+        }));
+    results.push_back(RunBenchmark("FindTopDocuments/par"s, repetitions, query_count, no_preparation, [&](size_t i) {
+        benchmark_sink = benchmark_sink + search_server->FindTopDocuments(std::execution::par, corpus.queries[i]).size();
+        }));
+    results.push_back(RunBenchmark("ProcessQueries"s, repetitions, 1, no_preparation, [&](size_t) {
+        benchmark_sink = benchmark_sink + ProcessQueries(*search_server, corpus.queries).size();
+        }));
+
+    // RemoveDuplicates сообщает о каждом дубликате в std::cout, а там может быть JSON с результатами
+    std::ostringstream discarded_output;
+    results.push_back(RunBenchmark("RemoveDuplicates"s, repetitions, 1, build_full, [&](size_t) {
+        auto* const cout_buffer = std::cout.rdbuf(discarded_output.rdbuf());
+        RemoveDuplicates(*search_server);
+        std::cout.rdbuf(cout_buffer);
+        discarded_output.str({});
+        }));
+    return results;
+}
+
+void PrintBenchmarkJson(std::ostream& out, const CorpusOptions& options, const std::vector<BenchmarkResult>& results) {
+    out << "{\n  \"corpus\": {"
+        << "\"dictionary_size\": " << options.dictionary_size
+        << ", \"max_word_length\": " << options.max_word_length
+        << ", \"zipf_exponent\": " << options.zipf_exponent
+        << ", \"document_count\": " << options.document_count
+        << ", \"min_document_length\": " << options.min_document_length
+        << ", \"max_document_length\": " << options.max_document_length
+        << ", \"duplicate_ratio\": " << options.duplicate_ratio
+        << ", \"query_count\": " << options.query_count
+        << ", \"min_query_length\": " << options.min_query_length
+        << ", \"max_query_length\": " << options.max_query_length
+        << ", \"minus_word_ratio\": " << options.minus_word_ratio
+        << ", \"seed\": " << options.seed << "},\n  \"benchmarks\": [";
+    bool is_first = true;
+    for (const auto& result : results) {
+        out << (is_first ? "\n" : ",\n") << "    {\"name\": ";
+        is_first = false;
+        PrintJsonString(out, result.name);
+        const auto [min_run, max_run] = std::minmax_element(result.run_milliseconds.begin(), result.run_milliseconds.end());
+        out << ", \"repetitions\": " << result.repetitions
+            << ", \"operations_per_run\": " << result.operations_per_run
+            << ", \"run_ms\": {\"min\": " << (result.run_milliseconds.empty() ? 0.0 : *min_run)
+            << ", \"median\": " << GetMedian(result.run_milliseconds)
+            << ", \"max\": " << (result.run_milliseconds.empty() ? 0.0 : *max_run) << "}"
+            << ", \"operation_ns\": {\"p50\": " << result.GetOperationPercentile(50)
+            << ", \"p90\": " << result.GetOperationPercentile(90)
+            << ", \"p99\": " << result.GetOperationPercentile(99)
+            << ", \"max\": " << result.GetOperationPercentile(100) << "}";
+        if (!result.timers.empty()) {
+            out << ", \"timers\": {";
+            bool is_first_timer = true;
+            for (const auto& [label, histogram] : result.timers) {
+                out << (is_first_timer ? "" : ", ");
+                is_first_timer = false;
+                PrintJsonString(out, label);
+                out << ": {\"count\": " << histogram.GetCount()
+                    << ", \"p50_ns\": " << histogram.GetPercentile(50)
+                    << ", \"p90_ns\": " << histogram.GetPercentile(90)
+                    << ", \"p99_ns\": " << histogram.GetPercentile(99)
+                    << ", \"max_ns\": " << histogram.GetPercentile(100) << "}";
+            }
+            out << "}";
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}" << std::endl;
+}
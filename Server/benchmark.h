@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "scoped_timer.h"
+
+// Параметры синтетического корпуса. Частоты слов подчиняются закону Ципфа, как в реальных текстах:
+// k-е по частоте слово встречается примерно в k^zipf_exponent раз реже первого
+struct CorpusOptions {
+    size_t dictionary_size = 10'000;
+    int max_word_length = 10;
+    double zipf_exponent = 1.0;
+    size_t document_count = 10'000;
+    int min_document_length = 10;
+    int max_document_length = 100;
+    // Доля документов, повторяющих набор слов одного из предыдущих, — для RemoveDuplicates
+    double duplicate_ratio = 0.05;
+    size_t query_count = 1'000;
+    int min_query_length = 1;
+    int max_query_length = 8;
+    double minus_word_ratio = 0.1;
+    uint32_t seed = 42;
+};
+
+struct Corpus {
+    // Первое слово словаря — самое частое, оно же стоп-слово сервера
+    std::vector<std::string> dictionary;
+    std::vector<std::string> documents;
+    std::vector<std::string> queries;
+};
+
+// Номера от 0 до size - 1 с вероятностями, пропорциональными 1 / (k + 1)^exponent
+class ZipfDistribution {
+public:
+    ZipfDistribution(size_t size, double exponent);
+
+    size_t operator()(std::mt19937& generator) const;
+
+private:
+    std::vector<double> cumulative_weights_;
+};
+
+Corpus GenerateCorpus(const CorpusOptions& options);
+
+struct BenchmarkResult {
+    std::string name;
+    size_t repetitions = 0;
+    size_t operations_per_run = 0;
+    // Время каждого прогона целиком
+    std::vector<double> run_milliseconds;
+    // Время отдельных операций всех прогонов, отсортированное по возрастанию
+    std::vector<uint64_t> operation_nanoseconds;
+    // Замеры SCOPED_TIMER за все прогоны по меткам: так видно время блоков внутри операции,
+    // в том числе на потоках, которые операция запустила
+    std::map<std::string, Histogram, std::less<>> timers;
+
+    uint64_t GetOperationPercentile(double percentile) const;
+};
+
+// Прогоняет бенчмарк repetitions раз. Перед каждым прогоном вызывается prepare() — его время не учитывается,
+// затем operation(i) для i от 0 до operation_count - 1, и время каждого вызова замеряется отдельно.
+// Гистограммы SCOPED_TIMER обнуляются перед первым прогоном
+template <typename Prepare, typename Operation>
+BenchmarkResult RunBenchmark(std::string name, size_t repetitions, size_t operation_count, Prepare prepare, Operation operation) {
+    using Clock = std::chrono::steady_clock;
+    BenchmarkResult result;
+    result.name = std::move(name);
+    result.repetitions = repetitions;
+    result.operations_per_run = operation_count;
+    result.operation_nanoseconds.reserve(repetitions * operation_count);
+    ResetTimerHistograms();
+    for (size_t run = 0; run < repetitions; ++run) {
+        prepare();
+        const auto run_start = Clock::now();
+        for (size_t i = 0; i < operation_count; ++i) {
+            const auto operation_start = Clock::now();
+            operation(i);
+            result.operation_nanoseconds.push_back(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - operation_start).count()));
+        }
+        result.run_milliseconds.push_back(std::chrono::duration<double, std::milli>(Clock::now() - run_start).count());
+    }
+    std::sort(result.operation_nanoseconds.begin(), result.operation_nanoseconds.end());
+    for (auto& [label, histogram] : GetTimerHistograms()) {
+        if (histogram.GetCount() > 0) {
+            result.timers.emplace(label, std::move(histogram));
+        }
+    }
+    return result;
+}
+
+// Бенчмарки AddDocument, RemoveDocument, MatchDocument, FindTopDocuments (seq и par), ProcessQueries и RemoveDuplicates.
+// MatchDocument пропускается, если в корпусе нет документов
+std::vector<BenchmarkResult> RunSearchServerBenchmarks(const Corpus& corpus, size_t repetitions);
+
+void PrintBenchmarkJson(std::ostream& out, const CorpusOptions& options, const std::vector<BenchmarkResult>& results);
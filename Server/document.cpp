@@ -26,4 +26,21 @@ void PrintMatchDocumentResult(int document_id, const std::vector<std::string_vie
         std::cout << ' ' << word;
     }
     std::cout << "}"s << std::endl;
-}
\ No newline at end of file
+}
+
+bool IsMoreRelevant(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.relevance > rhs.relevance;
+}
+
+bool IsRankedBefore(const Document& lhs, const Document& rhs) {
+    if (IsMoreRelevant(lhs, rhs)) {
+        return true;
+    }
+    if (IsMoreRelevant(rhs, lhs)) {
+        return false;
+    }
+    return lhs.id < rhs.id;
+}
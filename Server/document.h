@@ -3,6 +3,9 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <cmath>
+
+constexpr double EPSILON = 1e-6;
 
 struct Document {
     Document() = default;
@@ -23,8 +26,15 @@ enum class DocumentStatus {
     REMOVED
 };
 
+constexpr size_t DOCUMENT_STATUS_COUNT = 4;
+
 std::ostream& operator<<(std::ostream& out, const Document& document);
 
 void PrintDocument(const Document& document);
 
-void PrintMatchDocumentResult(int document_id, const std::vector<std::string_view>& words, DocumentStatus status);
\ No newline at end of file
+void PrintMatchDocumentResult(int document_id, const std::vector<std::string_view>& words, DocumentStatus status);
+
+bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
+// Строгий порядок выдачи: IsMoreRelevant, а при равенстве — меньший id раньше
+bool IsRankedBefore(const Document& lhs, const Document& rhs);
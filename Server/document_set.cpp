@@ -0,0 +1,366 @@
+#include "document_set.h"
+
+#include <algorithm>
+#include <bit>
+#include <iterator>
+
+namespace {
+
+constexpr uint32_t CONTAINER_SIZE = uint32_t{ 1 } << 16;
+
+uint16_t GetKey(int document_id) noexcept {
+    return static_cast<uint16_t>(static_cast<uint32_t>(document_id) >> 16);
+}
+
+uint16_t GetLowBits(int document_id) noexcept {
+    return static_cast<uint16_t>(static_cast<uint32_t>(document_id) & 0xFFFF);
+}
+
+} // namespace
+
+bool DocumentSet::Container::Contains(uint16_t value) const noexcept {
+    if (IsBitmap()) {
+        return (bitmap[value >> 6] >> (value & 63)) & 1;
+    }
+    return std::binary_search(values.begin(), values.end(), value);
+}
+
+bool DocumentSet::Container::Add(uint16_t value) {
+    if (IsBitmap()) {
+        uint64_t& word = bitmap[value >> 6];
+        const uint64_t mask = uint64_t{ 1 } << (value & 63);
+        if (word & mask) {
+            return false;
+        }
+        word |= mask;
+        ++cardinality;
+        return true;
+    }
+    // Id обычно добавляются по возрастанию, и тогда вставка идёт в конец массива
+    const auto position = values.empty() || values.back() < value ? values.end()
+        : std::lower_bound(values.begin(), values.end(), value);
+    if (position != values.end() && *position == value) {
+        return false;
+    }
+    values.insert(position, value);
+    ++cardinality;
+    Normalize();
+    return true;
+}
+
+bool DocumentSet::Container::Remove(uint16_t value) {
+    if (IsBitmap()) {
+        uint64_t& word = bitmap[value >> 6];
+        const uint64_t mask = uint64_t{ 1 } << (value & 63);
+        if (!(word & mask)) {
+            return false;
+        }
+        word &= ~mask;
+        --cardinality;
+        Normalize();
+        return true;
+    }
+    const auto position = std::lower_bound(values.begin(), values.end(), value);
+    if (position == values.end() || *position != value) {
+        return false;
+    }
+    values.erase(position);
+    --cardinality;
+    return true;
+}
+
+void DocumentSet::Container::Normalize() {
+    if (IsBitmap() && cardinality <= ARRAY_LIMIT) {
+        values.clear();
+        values.reserve(cardinality);
+        for (size_t i = 0; i < BITMAP_WORDS; ++i) {
+            for (uint64_t word = bitmap[i]; word != 0; word &= word - 1) {
+                values.push_back(static_cast<uint16_t>(i * 64 + std::countr_zero(word)));
+            }
+        }
+        bitmap.clear();
+        bitmap.shrink_to_fit();
+    }
+    else if (!IsBitmap() && cardinality > ARRAY_LIMIT) {
+        bitmap.assign(BITMAP_WORDS, 0);
+        for (const uint16_t value : values) {
+            bitmap[value >> 6] |= uint64_t{ 1 } << (value & 63);
+        }
+        values.clear();
+        values.shrink_to_fit();
+    }
+}
+
+uint32_t DocumentSet::Container::Seek(uint32_t position) const noexcept {
+    if (!IsBitmap()) {
+        return std::min<uint32_t>(position, static_cast<uint32_t>(values.size()));
+    }
+    if (position >= CONTAINER_SIZE) {
+        return CONTAINER_SIZE;
+    }
+    size_t index = position >> 6;
+    uint64_t word = bitmap[index] & (~uint64_t{ 0 } << (position & 63));
+    while (word == 0) {
+        if (++index == BITMAP_WORDS) {
+            return CONTAINER_SIZE;
+        }
+        word = bitmap[index];
+    }
+    return static_cast<uint32_t>(index * 64 + std::countr_zero(word));
+}
+
+int DocumentSet::const_iterator::operator*() const noexcept {
+    const uint32_t low_bits = container_->IsBitmap() ? position_ : container_->values[position_];
+    return static_cast<int>((uint32_t{ container_->key } << 16) | low_bits);
+}
+
+DocumentSet::const_iterator& DocumentSet::const_iterator::operator++() noexcept {
+    ++position_;
+    Settle();
+    return *this;
+}
+
+DocumentSet::const_iterator DocumentSet::const_iterator::operator++(int) noexcept {
+    const_iterator previous = *this;
+    ++*this;
+    return previous;
+}
+
+void DocumentSet::const_iterator::Settle() noexcept {
+    for (; container_ != last_; ++container_, position_ = 0) {
+        const uint32_t limit = container_->IsBitmap() ? CONTAINER_SIZE : static_cast<uint32_t>(container_->values.size());
+        position_ = container_->Seek(position_);
+        if (position_ < limit) {
+            return;
+        }
+    }
+    position_ = 0;
+}
+
+std::vector<DocumentSet::Container>::iterator DocumentSet::FindContainer(uint16_t key) {
+    return std::lower_bound(containers_.begin(), containers_.end(), key,
+        [](const Container& container, uint16_t value) { return container.key < value; });
+}
+
+std::vector<DocumentSet::Container>::const_iterator DocumentSet::FindContainer(uint16_t key) const {
+    return std::lower_bound(containers_.begin(), containers_.end(), key,
+        [](const Container& container, uint16_t value) { return container.key < value; });
+}
+
+bool DocumentSet::Add(int document_id) {
+    const uint16_t key = GetKey(document_id);
+    auto container = !containers_.empty() && containers_.back().key == key ? std::prev(containers_.end()) : FindContainer(key);
+    if (container == containers_.end() || container->key != key) {
+        container = containers_.insert(container, Container{});
+        container->key = key;
+    }
+    if (!container->Add(GetLowBits(document_id))) {
+        return false;
+    }
+    ++size_;
+    return true;
+}
+
+bool DocumentSet::Remove(int document_id) {
+    const auto container = FindContainer(GetKey(document_id));
+    if (container == containers_.end() || container->key != GetKey(document_id) || !container->Remove(GetLowBits(document_id))) {
+        return false;
+    }
+    if (container->cardinality == 0) {
+        containers_.erase(container);
+    }
+    --size_;
+    return true;
+}
+
+bool DocumentSet::Contains(int document_id) const noexcept {
+    const auto container = FindContainer(GetKey(document_id));
+    return container != containers_.end() && container->key == GetKey(document_id) && container->Contains(GetLowBits(document_id));
+}
+
+DocumentSet::const_iterator DocumentSet::begin() const noexcept {
+    const Container* last = containers_.data() + containers_.size();
+    const_iterator first(containers_.data(), last, 0);
+    first.Settle();
+    return first;
+}
+
+DocumentSet::const_iterator DocumentSet::end() const noexcept {
+    const Container* last = containers_.data() + containers_.size();
+    return const_iterator(last, last, 0);
+}
+
+DocumentSet::Container DocumentSet::Intersect(const Container& lhs, const Container& rhs) {
+    Container result;
+    result.key = lhs.key;
+    if (lhs.IsBitmap() && rhs.IsBitmap()) {
+        result.bitmap.resize(BITMAP_WORDS);
+        for (size_t i = 0; i < BITMAP_WORDS; ++i) {
+            result.bitmap[i] = lhs.bitmap[i] & rhs.bitmap[i];
+            result.cardinality += std::popcount(result.bitmap[i]);
+        }
+    }
+    else if (lhs.IsBitmap() || rhs.IsBitmap()) {
+        const Container& values = lhs.IsBitmap() ? rhs : lhs;
+        const Container& bitmap = lhs.IsBitmap() ? lhs : rhs;
+        std::copy_if(values.values.begin(), values.values.end(), std::back_inserter(result.values),
+            [&bitmap](uint16_t value) { return bitmap.Contains(value); });
+        result.cardinality = static_cast<uint32_t>(result.values.size());
+    }
+    else {
+        std::set_intersection(lhs.values.begin(), lhs.values.end(), rhs.values.begin(), rhs.values.end(),
+            std::back_inserter(result.values));
+        result.cardinality = static_cast<uint32_t>(result.values.size());
+    }
+    result.Normalize();
+    return result;
+}
+
+DocumentSet::Container DocumentSet::Unite(const Container& lhs, const Container& rhs) {
+    Container result;
+    result.key = lhs.key;
+    if (!lhs.IsBitmap() && !rhs.IsBitmap()) {
+        std::set_union(lhs.values.begin(), lhs.values.end(), rhs.values.begin(), rhs.values.end(),
+            std::back_inserter(result.values));
+        result.cardinality = static_cast<uint32_t>(result.values.size());
+        result.Normalize();
+        return result;
+    }
+    result.bitmap.assign(BITMAP_WORDS, 0);
+    for (const Container* container : { &lhs, &rhs }) {
+        if (container->IsBitmap()) {
+            for (size_t i = 0; i < BITMAP_WORDS; ++i) {
+                result.bitmap[i] |= container->bitmap[i];
+            }
+        }
+        else {
+            for (const uint16_t value : container->values) {
+                result.bitmap[value >> 6] |= uint64_t{ 1 } << (value & 63);
+            }
+        }
+    }
+    for (const uint64_t word : result.bitmap) {
+        result.cardinality += std::popcount(word);
+    }
+    return result;
+}
+
+DocumentSet::Container DocumentSet::Subtract(const Container& lhs, const Container& rhs) {
+    Container result;
+    result.key = lhs.key;
+    if (!lhs.IsBitmap()) {
+        if (rhs.IsBitmap()) {
+            std::copy_if(lhs.values.begin(), lhs.values.end(), std::back_inserter(result.values),
+                [&rhs](uint16_t value) { return !rhs.Contains(value); });
+        }
+        else {
+            std::set_difference(lhs.values.begin(), lhs.values.end(), rhs.values.begin(), rhs.values.end(),
+                std::back_inserter(result.values));
+        }
+        result.cardinality = static_cast<uint32_t>(result.values.size());
+        return result;
+    }
+    result.bitmap = lhs.bitmap;
+    if (rhs.IsBitmap()) {
+        for (size_t i = 0; i < BITMAP_WORDS; ++i) {
+            result.bitmap[i] &= ~rhs.bitmap[i];
+        }
+    }
+    else {
+        for (const uint16_t value : rhs.values) {
+            result.bitmap[value >> 6] &= ~(uint64_t{ 1 } << (value & 63));
+        }
+    }
+    for (const uint64_t word : result.bitmap) {
+        result.cardinality += std::popcount(word);
+    }
+    result.Normalize();
+    return result;
+}
+
+void DocumentSet::UpdateSize() noexcept {
+    size_ = 0;
+    for (const Container& container : containers_) {
+        size_ += container.cardinality;
+    }
+}
+
+DocumentSet& DocumentSet::operator&=(const DocumentSet& other) {
+    *this = *this & other;
+    return *this;
+}
+
+DocumentSet& DocumentSet::operator|=(const DocumentSet& other) {
+    std::vector<Container> containers;
+    containers.reserve(containers_.size() + other.containers_.size());
+    auto lhs = containers_.begin();
+    auto rhs = other.containers_.begin();
+    while (lhs != containers_.end() || rhs != other.containers_.end()) {
+        if (rhs == other.containers_.end() || (lhs != containers_.end() && lhs->key < rhs->key)) {
+            containers.push_back(std::move(*lhs++));
+        }
+        else if (lhs == containers_.end() || rhs->key < lhs->key) {
+            containers.push_back(*rhs++);
+        }
+        else {
+            containers.push_back(Unite(*lhs++, *rhs++));
+        }
+    }
+    containers_ = std::move(containers);
+    UpdateSize();
+    return *this;
+}
+
+DocumentSet& DocumentSet::operator-=(const DocumentSet& other) {
+    auto rhs = other.containers_.begin();
+    auto last = containers_.begin();
+    for (auto lhs = containers_.begin(); lhs != containers_.end(); ++lhs) {
+        while (rhs != other.containers_.end() && rhs->key < lhs->key) {
+            ++rhs;
+        }
+        if (rhs != other.containers_.end() && rhs->key == lhs->key) {
+            *lhs = Subtract(*lhs, *rhs);
+        }
+        if (lhs->cardinality > 0) {
+            if (last != lhs) {
+                *last = std::move(*lhs);
+            }
+            ++last;
+        }
+    }
+    containers_.erase(last, containers_.end());
+    UpdateSize();
+    return *this;
+}
+
+DocumentSet operator&(const DocumentSet& lhs, const DocumentSet& rhs) {
+    DocumentSet result;
+    auto lhs_container = lhs.containers_.begin();
+    auto rhs_container = rhs.containers_.begin();
+    while (lhs_container != lhs.containers_.end() && rhs_container != rhs.containers_.end()) {
+        if (lhs_container->key < rhs_container->key) {
+            ++lhs_container;
+        }
+        else if (rhs_container->key < lhs_container->key) {
+            ++rhs_container;
+        }
+        else {
+            DocumentSet::Container container = DocumentSet::Intersect(*lhs_container++, *rhs_container++);
+            if (container.cardinality > 0) {
+                result.containers_.push_back(std::move(container));
+            }
+        }
+    }
+    result.UpdateSize();
+    return result;
+}
+
+DocumentSet operator|(DocumentSet lhs, const DocumentSet& rhs) {
+    lhs |= rhs;
+    return lhs;
+}
+
+DocumentSet operator-(DocumentSet lhs, const DocumentSet& rhs) {
+    lhs -= rhs;
+    return lhs;
+}
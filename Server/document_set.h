@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+// Сжатое множество неотрицательных id документов в духе Roaring. Id делятся по старшим 16 битам
+// на контейнеры: в разреженном контейнере младшие биты лежат отсортированным массивом uint16_t,
+// в плотном (больше ARRAY_LIMIT элементов) — битовой картой на 2^16 бит. Пересечение, объединение
+// и разность идут по контейнерам словами по 64 бита или слиянием массивов, без обхода дерева
+class DocumentSet {
+    struct Container;
+
+public:
+    static constexpr size_t ARRAY_LIMIT = 4096;
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = int;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const int*;
+        using reference = int;
+
+        const_iterator() = default;
+
+        int operator*() const noexcept;
+        const_iterator& operator++() noexcept;
+        const_iterator operator++(int) noexcept;
+
+        bool operator==(const const_iterator& other) const noexcept {
+            return container_ == other.container_ && position_ == other.position_;
+        }
+
+        bool operator!=(const const_iterator& other) const noexcept {
+            return !(*this == other);
+        }
+
+    private:
+        friend class DocumentSet;
+
+        const_iterator(const Container* container, const Container* last, uint32_t position) noexcept
+            : container_(container)
+            , last_(last)
+            , position_(position) {
+        }
+
+        // Переходит к первому элементу не раньше position_, при необходимости в следующих контейнерах
+        void Settle() noexcept;
+
+        const Container* container_ = nullptr;
+        const Container* last_ = nullptr;
+        // Номер элемента массива или номер бита битовой карты
+        uint32_t position_ = 0;
+    };
+
+    using iterator = const_iterator;
+
+    // Возвращает false, если id уже был в множестве
+    bool Add(int document_id);
+    // Возвращает false, если id в множестве не было
+    bool Remove(int document_id);
+    bool Contains(int document_id) const noexcept;
+
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+
+    size_t size() const noexcept {
+        return size_;
+    }
+
+    bool empty() const noexcept {
+        return size_ == 0;
+    }
+
+    void clear() noexcept {
+        containers_.clear();
+        size_ = 0;
+    }
+
+    DocumentSet& operator&=(const DocumentSet& other);
+    DocumentSet& operator|=(const DocumentSet& other);
+    // Разность: убирает id, которые есть в other (ANDNOT)
+    DocumentSet& operator-=(const DocumentSet& other);
+
+    friend DocumentSet operator&(const DocumentSet& lhs, const DocumentSet& rhs);
+    friend DocumentSet operator|(DocumentSet lhs, const DocumentSet& rhs);
+    friend DocumentSet operator-(DocumentSet lhs, const DocumentSet& rhs);
+
+private:
+    static constexpr size_t BITMAP_WORDS = (size_t{ 1 } << 16) / 64;
+
+    struct Container {
+        uint16_t key = 0;
+        uint32_t cardinality = 0;
+        // Заполнено что-то одно: bitmap у плотного контейнера, values у разреженного
+        std::vector<uint16_t> values;
+        std::vector<uint64_t> bitmap;
+
+        bool IsBitmap() const noexcept {
+            return !bitmap.empty();
+        }
+
+        bool Contains(uint16_t value) const noexcept;
+        bool Add(uint16_t value);
+        bool Remove(uint16_t value);
+        // Приводит форму контейнера к его размеру
+        void Normalize();
+        // Первый элемент не меньше position: номер в values или номер бита; 2^16 или values.size(), если его нет
+        uint32_t Seek(uint32_t position) const noexcept;
+    };
+
+    static Container Intersect(const Container& lhs, const Container& rhs);
+    static Container Unite(const Container& lhs, const Container& rhs);
+    static Container Subtract(const Container& lhs, const Container& rhs);
+
+    std::vector<Container>::iterator FindContainer(uint16_t key);
+    std::vector<Container>::const_iterator FindContainer(uint16_t key) const;
+    void UpdateSize() noexcept;
+
+    std::vector<Container> containers_;
+    size_t size_ = 0;
+};
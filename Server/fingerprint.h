@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// 128-битный отпечаток множества слов. Вклады слов складываются, поэтому порядок слов
+// не важен; совпадение отпечатков нужно подтверждать сравнением самих множеств
+struct WordSetFingerprint {
+    uint64_t low = 0;
+    uint64_t high = 0;
+
+    bool operator==(const WordSetFingerprint& other) const noexcept {
+        return low == other.low && high == other.high;
+    }
+};
+
+struct WordSetFingerprintHasher {
+    size_t operator()(const WordSetFingerprint& fingerprint) const noexcept {
+        return static_cast<size_t>(fingerprint.low ^ (fingerprint.high * 0x9E3779B97F4A7C15ull));
+    }
+};
+
+// Финализатор splitmix64: близкие id слов дают независимые на вид 64-битные значения
+inline uint64_t MixTermId(uint64_t value, uint64_t seed) noexcept {
+    value += seed + 0x9E3779B97F4A7C15ull;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+
+template <typename TermIds>
+WordSetFingerprint ComputeWordSetFingerprint(const TermIds& term_ids) noexcept {
+    WordSetFingerprint fingerprint;
+    for (const int term_id : term_ids) {
+        fingerprint.low += MixTermId(static_cast<uint64_t>(term_id), 0x243F6A8885A308D3ull);
+        fingerprint.high += MixTermId(static_cast<uint64_t>(term_id), 0x13198A2E03707344ull);
+    }
+    return fingerprint;
+}
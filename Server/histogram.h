@@ -0,0 +1,104 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+
+// Гистограмма в духе HDR: значения меньше SUB_BUCKET_COUNT хранятся точно, а каждый следующий
+// диапазон [2^k, 2^(k+1)) делится на SUB_BUCKET_COUNT равных корзин. Относительная погрешность
+// не больше 1 / SUB_BUCKET_COUNT на всём диапазоне uint64_t
+class Histogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 5;
+    static constexpr size_t SUB_BUCKET_COUNT = size_t{ 1 } << SUB_BUCKET_BITS;
+    static constexpr size_t BUCKET_COUNT = SUB_BUCKET_COUNT + (64 - SUB_BUCKET_BITS) * SUB_BUCKET_COUNT;
+
+    static constexpr size_t GetBucketIndex(uint64_t value) noexcept {
+        if (value < SUB_BUCKET_COUNT) {
+            return static_cast<size_t>(value);
+        }
+        const int shift = std::bit_width(value) - 1 - SUB_BUCKET_BITS;
+        const auto sub_bucket = static_cast<size_t>(value >> shift) - SUB_BUCKET_COUNT;
+        return SUB_BUCKET_COUNT + static_cast<size_t>(shift) * SUB_BUCKET_COUNT + sub_bucket;
+    }
+
+    static constexpr uint64_t GetBucketUpperBound(size_t index) noexcept {
+        if (index < SUB_BUCKET_COUNT) {
+            return index;
+        }
+        const size_t shift = (index - SUB_BUCKET_COUNT) / SUB_BUCKET_COUNT;
+        const uint64_t mantissa = SUB_BUCKET_COUNT + (index - SUB_BUCKET_COUNT) % SUB_BUCKET_COUNT;
+        return (mantissa << shift) + ((uint64_t{ 1 } << shift) - 1);
+    }
+
+    void Add(uint64_t value, uint64_t count = 1) noexcept {
+        AddToBucket(GetBucketIndex(value), count);
+    }
+
+    void AddToBucket(size_t index, uint64_t count) noexcept {
+        buckets_[index] += count;
+        total_ += count;
+    }
+
+    void Merge(const Histogram& other) noexcept {
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            buckets_[i] += other.buckets_[i];
+        }
+        total_ += other.total_;
+    }
+
+    uint64_t GetCount() const noexcept {
+        return total_;
+    }
+
+    uint64_t GetBucketCount(size_t index) const noexcept {
+        return buckets_[index];
+    }
+
+    // Верхняя граница корзины, в которую попадает заданный перцентиль (0..100)
+    uint64_t GetPercentile(double percentile) const noexcept {
+        if (total_ == 0) {
+            return 0;
+        }
+        const auto rank = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(total_ - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            seen += buckets_[i];
+            if (seen >= rank) {
+                return GetBucketUpperBound(i);
+            }
+        }
+        return GetBucketUpperBound(BUCKET_COUNT - 1);
+    }
+
+private:
+    std::array<uint64_t, BUCKET_COUNT> buckets_{};
+    uint64_t total_ = 0;
+};
+
+// Гистограмма с теми же корзинами, в которую можно писать, пока другой поток её читает
+class AtomicHistogram {
+public:
+    void Add(uint64_t value) noexcept {
+        buckets_[Histogram::GetBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void MergeTo(Histogram& histogram) const noexcept {
+        for (size_t i = 0; i < Histogram::BUCKET_COUNT; ++i) {
+            if (const uint64_t count = buckets_[i].load(std::memory_order_relaxed)) {
+                histogram.AddToBucket(i, count);
+            }
+        }
+    }
+
+    void Reset() noexcept {
+        for (auto& bucket : buckets_) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, Histogram::BUCKET_COUNT> buckets_{};
+};
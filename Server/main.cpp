@@ -1,74 +1,81 @@
-#include "search_server.h"
-#include "log_duration.h"
-#include "process_queries.h"
-#include <execution>
+#include "benchmark.h"
+#include "search_server_tests.h"
+
+#include <cstdlib>
 #include <iostream>
-#include <random>
+#include <stdexcept>
 #include <string>
-#include <vector>
+#include <string_view>
 
 using namespace std;
 
-string GenerateWord(mt19937& generator, int max_length) {
-    const int length = uniform_int_distribution(1, max_length)(generator);
-    string word;
-    word.reserve(length);
-    for (int i = 0; i < length; ++i) {
-        word.push_back(uniform_int_distribution<int>('a', 'z')(generator));
-    }
-    return word;
-}
-vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length) {
-    vector<string> words;
-    words.reserve(word_count);
-    for (int i = 0; i < word_count; ++i) {
-        words.push_back(GenerateWord(generator, max_length));
+// Параметры корпуса задаются парами "--имя значение", например: --documents 100000 --zipf 1.1 --repetitions 10.
+// Результаты печатаются в stdout в формате JSON. Запуск с единственным параметром --test выполняет модульные тесты
+int main(int argc, char* argv[]) {
+    if (argc == 2 && argv[1] == "--test"sv) {
+        TestSearchServer();
+        return EXIT_SUCCESS;
     }
-    words.erase(unique(words.begin(), words.end()), words.end());
-    return words;
-}
-string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int word_count, double minus_prob = 0) {
-    string query;
-    for (int i = 0; i < word_count; ++i) {
-        if (!query.empty()) {
-            query.push_back(' ');
+    CorpusOptions options;
+    size_t repetitions = 5;
+    try {
+        for (int i = 1; i < argc; i += 2) {
+            const string_view name = argv[i];
+            if (i + 1 == argc) {
+                throw invalid_argument("Не задано значение параметра "s + string(name));
+            }
+            const string value = argv[i + 1];
+            if (name == "--dictionary"sv) {
+                options.dictionary_size = stoul(value);
+            }
+            else if (name == "--word-length"sv) {
+                options.max_word_length = stoi(value);
+            }
+            else if (name == "--zipf"sv) {
+                options.zipf_exponent = stod(value);
+            }
+            else if (name == "--documents"sv) {
+                options.document_count = stoul(value);
+            }
+            else if (name == "--min-document-length"sv) {
+                options.min_document_length = stoi(value);
+            }
+            else if (name == "--max-document-length"sv) {
+                options.max_document_length = stoi(value);
+            }
+            else if (name == "--duplicates"sv) {
+                options.duplicate_ratio = stod(value);
+            }
+            else if (name == "--queries"sv) {
+                options.query_count = stoul(value);
+            }
+            else if (name == "--min-query-length"sv) {
+                options.min_query_length = stoi(value);
+            }
+            else if (name == "--max-query-length"sv) {
+                options.max_query_length = stoi(value);
+            }
+            else if (name == "--minus"sv) {
+                options.minus_word_ratio = stod(value);
+            }
+            else if (name == "--seed"sv) {
+                options.seed = static_cast<uint32_t>(stoul(value));
+            }
+            else if (name == "--repetitions"sv) {
+                repetitions = stoul(value);
+            }
+            else {
+                throw invalid_argument("Неизвестный параметр "s + string(name));
+            }
         }
-        if (uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
-            query.push_back('-');
+        if (options.document_count == 0) {
+            throw invalid_argument("Количество документов должно быть положительным"s);
         }
-        query += dictionary[uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
+        const Corpus corpus = GenerateCorpus(options);
+        PrintBenchmarkJson(cout, options, RunSearchServerBenchmarks(corpus, repetitions));
     }
-    return query;
-}
-vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count) {
-    vector<string> queries;
-    queries.reserve(query_count);
-    for (int i = 0; i < query_count; ++i) {
-        queries.push_back(GenerateQuery(generator, dictionary, max_word_count));
+    catch (const exception& e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
     }
-    return queries;
 }
-template <typename ExecutionPolicy>
-void Test(string_view mark, const SearchServer& search_server, const vector<string>& queries, ExecutionPolicy&& policy) {
-    LOG_DURATION(mark);
-    double total_relevance = 0;
-    for (const string_view query : queries) {
-        for (const auto& document : search_server.FindTopDocuments(policy, query)) {
-            total_relevance += document.relevance;
-        }
-    }
-    cout << total_relevance << endl;
-}
-#define TEST(policy) Test(#policy, search_server, queries, execution::policy)
-int main() {
-    mt19937 generator;
-    const auto dictionary = GenerateDictionary(generator, 1000, 10);
-    const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
-    SearchServer search_server(dictionary[0]);
-    for (size_t i = 0; i < documents.size(); ++i) {
-        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
-    }
-    const auto queries = GenerateQueries(generator, dictionary, 100, 70);
-    TEST(seq);
-    TEST(par);
-}
\ No newline at end of file
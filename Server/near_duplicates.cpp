@@ -0,0 +1,117 @@
+#include "near_duplicates.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include "fingerprint.h"
+
+using namespace std::string_literals;
+
+NearDuplicateIndex::NearDuplicateIndex(NearDuplicateOptions options)
+    : options_(options)
+    , bands_(options.band_count) {
+    if (options.band_count == 0 || options.rows_per_band == 0) {
+        throw std::invalid_argument("Сигнатура должна содержать хотя бы одну полосу и одну строку"s);
+    }
+    row_seeds_.reserve(options.band_count * options.rows_per_band);
+    for (size_t row = 0; row < options.band_count * options.rows_per_band; ++row) {
+        row_seeds_.push_back(MixTermId(row, 0xA4093822299F31D0ull));
+    }
+}
+
+const NearDuplicateOptions& NearDuplicateIndex::GetOptions() const noexcept {
+    return options_;
+}
+
+void NearDuplicateIndex::Add(int document_id, const std::vector<int>& term_ids) {
+    auto signature = ComputeSignature(term_ids);
+    for (size_t band = 0; band < bands_.size(); ++band) {
+        bands_[band][ComputeBandKey(signature, band)].push_back(document_id);
+    }
+    signatures_[document_id] = std::move(signature);
+}
+
+void NearDuplicateIndex::Remove(int document_id) {
+    const auto signature = signatures_.find(document_id);
+    if (signature == signatures_.end()) {
+        return;
+    }
+    for (size_t band = 0; band < bands_.size(); ++band) {
+        const auto bucket = bands_[band].find(ComputeBandKey(signature->second, band));
+        auto& ids = bucket->second;
+        ids.erase(std::remove(ids.begin(), ids.end(), document_id), ids.end());
+        if (ids.empty()) {
+            bands_[band].erase(bucket);
+        }
+    }
+    signatures_.erase(signature);
+}
+
+std::vector<int> NearDuplicateIndex::FindCandidates(int document_id) const {
+    std::vector<int> candidates;
+    const auto signature = signatures_.find(document_id);
+    if (signature == signatures_.end()) {
+        return candidates;
+    }
+    for (size_t band = 0; band < bands_.size(); ++band) {
+        const auto& ids = bands_[band].at(ComputeBandKey(signature->second, band));
+        std::copy_if(ids.begin(), ids.end(), std::back_inserter(candidates), [document_id](int id) { return id != document_id; });
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    return candidates;
+}
+
+double NearDuplicateIndex::EstimateJaccard(int lhs_document_id, int rhs_document_id) const {
+    const auto& lhs = signatures_.at(lhs_document_id);
+    const auto& rhs = signatures_.at(rhs_document_id);
+    size_t equal = 0;
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        equal += lhs[i] == rhs[i];
+    }
+    return static_cast<double>(equal) / lhs.size();
+}
+
+std::vector<uint64_t> NearDuplicateIndex::ComputeSignature(const std::vector<int>& term_ids) const {
+    std::vector<uint64_t> signature(row_seeds_.size(), std::numeric_limits<uint64_t>::max());
+    for (const int term_id : term_ids) {
+        for (size_t i = 0; i < signature.size(); ++i) {
+            signature[i] = std::min(signature[i], MixTermId(static_cast<uint64_t>(term_id) ^ row_seeds_[i], 0));
+        }
+    }
+    return signature;
+}
+
+uint64_t NearDuplicateIndex::ComputeBandKey(const std::vector<uint64_t>& signature, size_t band) const {
+    uint64_t key = band;
+    for (size_t row = 0; row < options_.rows_per_band; ++row) {
+        key = MixTermId(key ^ signature[band * options_.rows_per_band + row], row);
+    }
+    return key;
+}
+
+double ComputeJaccard(const std::vector<int>& lhs_term_ids, const std::vector<int>& rhs_term_ids) {
+    if (lhs_term_ids.empty() && rhs_term_ids.empty()) {
+        return 1.0;
+    }
+    size_t common = 0;
+    auto lhs = lhs_term_ids.begin();
+    auto rhs = rhs_term_ids.begin();
+    while (lhs != lhs_term_ids.end() && rhs != rhs_term_ids.end()) {
+        if (*lhs < *rhs) {
+            ++lhs;
+        }
+        else if (*rhs < *lhs) {
+            ++rhs;
+        }
+        else {
+            ++common;
+            ++lhs;
+            ++rhs;
+        }
+    }
+    return static_cast<double>(common) / (lhs_term_ids.size() + rhs_term_ids.size() - common);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+struct NearDuplicateOptions {
+    // Сигнатура из band_count * rows_per_band MinHash-значений. Пара попадает в кандидаты,
+    // если хотя бы одна полоса совпала целиком
+    size_t band_count = 16;
+    size_t rows_per_band = 4;
+    // Минимальная мера Жаккара множеств слов, при которой документы считаются почти дубликатами
+    double jaccard_threshold = 0.8;
+
+    bool operator==(const NearDuplicateOptions& other) const noexcept = default;
+};
+
+// MinHash-сигнатуры документов, разложенные по LSH-полосам: поиск похожих документов
+// смотрит только на соседей по полосам, а не на весь корпус
+class NearDuplicateIndex {
+public:
+    explicit NearDuplicateIndex(NearDuplicateOptions options = {});
+
+    const NearDuplicateOptions& GetOptions() const noexcept;
+
+    void Add(int document_id, const std::vector<int>& term_ids);
+
+    void Remove(int document_id);
+
+    // Документы, совпавшие с данным хотя бы в одной полосе
+    std::vector<int> FindCandidates(int document_id) const;
+
+    double EstimateJaccard(int lhs_document_id, int rhs_document_id) const;
+
+private:
+    NearDuplicateOptions options_;
+    // Сид каждой строки сигнатуры перемешан отдельно от id слова, иначе соседние строки
+    // хешируют сдвинутые на единицу id и почти не отличаются друг от друга
+    std::vector<uint64_t> row_seeds_;
+    std::unordered_map<int, std::vector<uint64_t>> signatures_;
+    std::vector<std::unordered_map<uint64_t, std::vector<int>>> bands_;
+
+    std::vector<uint64_t> ComputeSignature(const std::vector<int>& term_ids) const;
+
+    uint64_t ComputeBandKey(const std::vector<uint64_t>& signature, size_t band) const;
+};
+
+double ComputeJaccard(const std::vector<int>& lhs_term_ids, const std::vector<int>& rhs_term_ids);
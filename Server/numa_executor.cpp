@@ -0,0 +1,156 @@
+#include "numa_executor.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std::string_literals;
+
+namespace {
+#if defined(__linux__)
+    // Формат cpulist и списка узлов: "0-3,8-11"
+    std::vector<int> ParseRangeList(const std::string& text) {
+        std::vector<int> values;
+        std::istringstream input(text);
+        std::string range;
+        while (std::getline(input, range, ',')) {
+            if (range.empty() || range == "\n"s) {
+                continue;
+            }
+            const size_t dash = range.find('-');
+            const int first = std::stoi(range.substr(0, dash));
+            const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int value = first; value <= last; ++value) {
+                values.push_back(value);
+            }
+        }
+        return values;
+    }
+#endif
+}
+
+std::vector<size_t> GetNumaNodes() {
+    std::vector<size_t> nodes;
+#if defined(_WIN32)
+    ULONG highest_node = 0;
+    if (GetNumaHighestNodeNumber(&highest_node)) {
+        for (ULONG node = 0; node <= highest_node; ++node) {
+            nodes.push_back(node);
+        }
+    }
+#elif defined(__linux__)
+    // Узлы нумеруются с пропусками, поэтому их список берётся целиком, а не перебором node0, node1, ...
+    std::ifstream input("/sys/devices/system/node/online"s);
+    std::string text;
+    std::getline(input, text);
+    for (const int node : ParseRangeList(text)) {
+        nodes.push_back(static_cast<size_t>(node));
+    }
+#endif
+    if (nodes.empty()) {
+        nodes.push_back(0);
+    }
+    return nodes;
+}
+
+size_t GetNumaNodeCount() {
+    return GetNumaNodes().size();
+}
+
+std::vector<int> GetNumaNodeCpus(size_t node) {
+#if defined(_WIN32)
+    std::vector<int> cpus;
+    GROUP_AFFINITY affinity{};
+    if (GetNumaNodeProcessorMaskEx(static_cast<USHORT>(node), &affinity)) {
+        for (int cpu = 0; cpu < static_cast<int>(sizeof(KAFFINITY) * 8); ++cpu) {
+            if (affinity.Mask & (KAFFINITY{ 1 } << cpu)) {
+                cpus.push_back(affinity.Group * 64 + cpu);
+            }
+        }
+    }
+    return cpus;
+#elif defined(__linux__)
+    std::ifstream input("/sys/devices/system/node/node"s + std::to_string(node) + "/cpulist"s);
+    std::string text;
+    std::getline(input, text);
+    return ParseRangeList(text);
+#else
+    return {};
+#endif
+}
+
+bool BindCurrentThreadToNumaNode(size_t node) {
+#if defined(_WIN32)
+    GROUP_AFFINITY affinity{};
+    if (!GetNumaNodeProcessorMaskEx(static_cast<USHORT>(node), &affinity)) {
+        return false;
+    }
+    return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+#elif defined(__linux__)
+    const std::vector<int> cpus = GetNumaNodeCpus(node);
+    if (cpus.empty()) {
+        return false;
+    }
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (int cpu : cpus) {
+        CPU_SET(cpu, &cpu_set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+#else
+    return false;
+#endif
+}
+
+NumaNodeExecutor::NumaNodeExecutor(size_t node, size_t thread_count) : node_(node) {
+    if (thread_count == 0) {
+        thread_count = std::max<size_t>(GetNumaNodeCpus(node).size(), 1);
+    }
+    threads_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads_.emplace_back([this] {
+            BindCurrentThreadToNumaNode(node_);
+            Run();
+            });
+    }
+}
+
+NumaNodeExecutor::~NumaNodeExecutor() {
+    {
+        std::lock_guard guard(mutex_);
+        stopping_ = true;
+    }
+    has_tasks_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+size_t NumaNodeExecutor::GetNode() const noexcept {
+    return node_;
+}
+
+void NumaNodeExecutor::Run() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mutex_);
+            has_tasks_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+            if (tasks_.empty()) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Номера узлов, которые сейчас в системе. Номера могут идти с пропусками, например 0 и 2;
+// если платформа не сообщает об узлах, есть один узел 0
+std::vector<size_t> GetNumaNodes();
+
+size_t GetNumaNodeCount();
+
+std::vector<int> GetNumaNodeCpus(size_t node);
+
+// Привязывает текущий поток к процессорам узла; false, если платформа этого не умеет
+bool BindCurrentThreadToNumaNode(size_t node);
+
+// Пул потоков, закреплённых за одним NUMA-узлом. Память, которую задачи выделяют впервые,
+// по политике first-touch оказывается на этом же узле
+class NumaNodeExecutor {
+public:
+    explicit NumaNodeExecutor(size_t node, size_t thread_count = 0);
+
+    NumaNodeExecutor(const NumaNodeExecutor&) = delete;
+    NumaNodeExecutor& operator=(const NumaNodeExecutor&) = delete;
+
+    ~NumaNodeExecutor();
+
+    size_t GetNode() const noexcept;
+
+    template <typename Function>
+    auto Submit(Function function) -> std::future<std::invoke_result_t<Function>>;
+
+private:
+    size_t node_;
+    std::mutex mutex_;
+    std::condition_variable has_tasks_;
+    std::deque<std::function<void()>> tasks_;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+
+    void Run();
+};
+
+template <typename Function>
+auto NumaNodeExecutor::Submit(Function function) -> std::future<std::invoke_result_t<Function>> {
+    using Result = std::invoke_result_t<Function>;
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::move(function));
+    auto result = task->get_future();
+    {
+        std::lock_guard guard(mutex_);
+        tasks_.emplace_back([task] { (*task)(); });
+    }
+    has_tasks_.notify_one();
+    return result;
+}
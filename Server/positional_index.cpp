@@ -0,0 +1,95 @@
+#include "positional_index.h"
+
+#include <algorithm>
+#include <iterator>
+
+void PositionalIndex::Add(int document_id, std::vector<std::pair<int, uint32_t>> term_positions) {
+    std::sort(term_positions.begin(), term_positions.end());
+    for (auto it = term_positions.begin(); it != term_positions.end();) {
+        const int term_id = it->first;
+        std::vector<uint8_t>& encoded = term_to_document_positions_[term_id][document_id];
+        uint32_t previous = 0;
+        for (; it != term_positions.end() && it->first == term_id; ++it) {
+            EncodePosition(it->second - previous, encoded);
+            previous = it->second;
+        }
+        encoded.shrink_to_fit();
+    }
+}
+
+void PositionalIndex::Remove(int document_id, const std::vector<int>& term_ids) {
+    for (const int term_id : term_ids) {
+        const auto document_positions = term_to_document_positions_.find(term_id);
+        if (document_positions == term_to_document_positions_.end()) {
+            continue;
+        }
+        document_positions->second.erase(document_id);
+        if (document_positions->second.empty()) {
+            term_to_document_positions_.erase(document_positions);
+        }
+    }
+}
+
+std::vector<uint32_t> PositionalIndex::GetPositions(int term_id, int document_id) const {
+    std::vector<uint32_t> positions;
+    const auto document_positions = term_to_document_positions_.find(term_id);
+    if (document_positions == term_to_document_positions_.end()) {
+        return positions;
+    }
+    const auto encoded = document_positions->second.find(document_id);
+    if (encoded == document_positions->second.end()) {
+        return positions;
+    }
+    uint32_t position = 0;
+    uint32_t delta = 0;
+    int shift = 0;
+    for (const uint8_t byte : encoded->second) {
+        delta |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (byte & 0x80) {
+            shift += 7;
+            continue;
+        }
+        position += delta;
+        positions.push_back(position);
+        delta = 0;
+        shift = 0;
+    }
+    return positions;
+}
+
+bool PositionalIndex::ContainsPhrase(int document_id, const Phrase& phrase) const {
+    // Возможные начала фразы: позиции каждого слова, сдвинутые на его смещение, пересекаются
+    // с уже найденными. Позиции возрастают, поэтому хватает слияния
+    std::vector<uint32_t> starts;
+    std::vector<uint32_t> term_starts;
+    std::vector<uint32_t> common_starts;
+    for (size_t i = 0; i < phrase.size(); ++i) {
+        const auto [term_id, offset] = phrase[i];
+        term_starts.clear();
+        for (const uint32_t position : GetPositions(term_id, document_id)) {
+            if (position >= offset) {
+                term_starts.push_back(position - offset);
+            }
+        }
+        if (i == 0) {
+            starts.swap(term_starts);
+        }
+        else {
+            common_starts.clear();
+            std::set_intersection(starts.begin(), starts.end(), term_starts.begin(), term_starts.end(), std::back_inserter(common_starts));
+            starts.swap(common_starts);
+        }
+        if (starts.empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void PositionalIndex::EncodePosition(uint32_t delta, std::vector<uint8_t>& encoded) {
+    while (delta >= 0x80) {
+        encoded.push_back(static_cast<uint8_t>(delta | 0x80));
+        delta >>= 7;
+    }
+    encoded.push_back(static_cast<uint8_t>(delta));
+}
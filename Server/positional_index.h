@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Позиции слов в документах. Позиция — номер слова в тексте с учётом стоп-слов, так что
+// фраза со стоп-словом внутри не совпадёт с текстом, где на его месте стоит другое число слов.
+// Позиции одного слова в документе хранятся разностями от предыдущей в переменной длине (varint)
+class PositionalIndex {
+public:
+    // Слова фразы: id слова и его смещение от начала фразы
+    using Phrase = std::vector<std::pair<int, uint32_t>>;
+
+    // term_positions — пары (id слова, позиция) в любом порядке
+    void Add(int document_id, std::vector<std::pair<int, uint32_t>> term_positions);
+
+    // term_ids — id всех слов документа, как их отдаёт SearchServer::GetDocumentTermIds
+    void Remove(int document_id, const std::vector<int>& term_ids);
+
+    std::vector<uint32_t> GetPositions(int term_id, int document_id) const;
+
+    bool ContainsPhrase(int document_id, const Phrase& phrase) const;
+
+private:
+    std::unordered_map<int, std::map<int, std::vector<uint8_t>>> term_to_document_positions_;
+
+    static void EncodePosition(uint32_t delta, std::vector<uint8_t>& encoded);
+};
@@ -0,0 +1,92 @@
+#include "query_stats.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct ThreadBuffer {
+    std::mutex mutex;
+    QueryStatsSummary summary;
+};
+
+struct BufferRegistry {
+    std::mutex mutex;
+    // Буфер переживает свой поток: завершённые потоки остаются в сводке
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+};
+
+BufferRegistry& GetRegistry() {
+    static BufferRegistry registry;
+    return registry;
+}
+
+ThreadBuffer& GetThreadBuffer() {
+    thread_local const std::shared_ptr<ThreadBuffer> buffer = [] {
+        auto new_buffer = std::make_shared<ThreadBuffer>();
+        BufferRegistry& registry = GetRegistry();
+        std::lock_guard guard(registry.mutex);
+        registry.buffers.push_back(new_buffer);
+        return new_buffer;
+    }();
+    return *buffer;
+}
+
+}  // namespace
+
+thread_local QueryStats* QueryStatsScope::current_ = nullptr;
+
+void QueryStatsSummary::Add(const QueryStats& stats) noexcept {
+    ++query_count;
+    terms_looked_up.Add(stats.terms_looked_up);
+    postings_scanned.Add(stats.postings_scanned);
+    candidates_scored.Add(stats.candidates_scored);
+    documents_excluded.Add(stats.documents_excluded);
+    parse_nanoseconds.Add(stats.parse_nanoseconds);
+    score_nanoseconds.Add(stats.score_nanoseconds);
+    select_nanoseconds.Add(stats.select_nanoseconds);
+}
+
+void QueryStatsSummary::Merge(const QueryStatsSummary& other) noexcept {
+    query_count += other.query_count;
+    terms_looked_up.Merge(other.terms_looked_up);
+    postings_scanned.Merge(other.postings_scanned);
+    candidates_scored.Merge(other.candidates_scored);
+    documents_excluded.Merge(other.documents_excluded);
+    parse_nanoseconds.Merge(other.parse_nanoseconds);
+    score_nanoseconds.Merge(other.score_nanoseconds);
+    select_nanoseconds.Merge(other.select_nanoseconds);
+}
+
+void QueryStatsScope::Finish() {
+    ThreadBuffer& buffer = GetThreadBuffer();
+    {
+        // Мьютекс захватывается чужим потоком только на время слияния сводки
+        std::lock_guard guard(buffer.mutex);
+        buffer.summary.Add(stats_);
+    }
+    if (out_ != nullptr) {
+        *out_ = stats_;
+    }
+}
+
+QueryStatsSummary GetQueryStatsSummary() {
+    QueryStatsSummary summary;
+    BufferRegistry& registry = GetRegistry();
+    std::lock_guard registry_guard(registry.mutex);
+    for (const auto& buffer : registry.buffers) {
+        std::lock_guard guard(buffer->mutex);
+        summary.Merge(buffer->summary);
+    }
+    return summary;
+}
+
+void ResetQueryStatsSummary() {
+    BufferRegistry& registry = GetRegistry();
+    std::lock_guard registry_guard(registry.mutex);
+    for (const auto& buffer : registry.buffers) {
+        std::lock_guard guard(buffer->mutex);
+        buffer->summary = {};
+    }
+}
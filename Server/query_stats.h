@@ -0,0 +1,109 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "histogram.h"
+
+// Статистика запросов собирается, только если проект собран с SEARCH_SERVER_QUERY_STATS.
+// Без него QueryStatsScope::Current() — константный nullptr, и все проверки на горячем пути выбрасываются компилятором
+#ifdef SEARCH_SERVER_QUERY_STATS
+constexpr bool QUERY_STATS_ENABLED = true;
+#else
+constexpr bool QUERY_STATS_ENABLED = false;
+#endif
+
+// Счётчики одного запроса
+struct QueryStats {
+    // Слова запроса, которые искались в индексе
+    uint64_t terms_looked_up = 0;
+    uint64_t postings_scanned = 0;
+    // Документы, получившие ненулевую релевантность
+    uint64_t candidates_scored = 0;
+    // Кандидаты, отброшенные минус-словами или фразами
+    uint64_t documents_excluded = 0;
+    uint64_t parse_nanoseconds = 0;
+    uint64_t score_nanoseconds = 0;
+    uint64_t select_nanoseconds = 0;
+};
+
+// Распределения счётчиков по всем запросам всех потоков
+struct QueryStatsSummary {
+    uint64_t query_count = 0;
+    Histogram terms_looked_up;
+    Histogram postings_scanned;
+    Histogram candidates_scored;
+    Histogram documents_excluded;
+    Histogram parse_nanoseconds;
+    Histogram score_nanoseconds;
+    Histogram select_nanoseconds;
+
+    void Add(const QueryStats& stats) noexcept;
+
+    void Merge(const QueryStatsSummary& other) noexcept;
+};
+
+// Границы запроса. Внешний объект на потоке становится текущим: вложенные (например, перегрузка,
+// вызвавшая другую перегрузку) пишут в его счётчики. Разрушаясь, внешний объект добавляет запрос
+// в буфер своего потока и копирует счётчики в out, если он задан
+class QueryStatsScope {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit QueryStatsScope(QueryStats* out = nullptr) noexcept {
+        if constexpr (QUERY_STATS_ENABLED) {
+            out_ = out;
+            is_outer_ = current_ == nullptr;
+            if (is_outer_) {
+                current_ = &stats_;
+            }
+            phase_start_ = Clock::now();
+        }
+    }
+
+    QueryStatsScope(const QueryStatsScope&) = delete;
+    QueryStatsScope& operator=(const QueryStatsScope&) = delete;
+
+    ~QueryStatsScope() {
+        if constexpr (QUERY_STATS_ENABLED) {
+            if (is_outer_) {
+                current_ = nullptr;
+                Finish();
+            }
+        }
+    }
+
+    // Прибавляет к фазе время, прошедшее с конструктора или предыдущего вызова
+    void FinishPhase(uint64_t QueryStats::* phase) noexcept {
+        if constexpr (QUERY_STATS_ENABLED) {
+            const auto now = Clock::now();
+            current_->*phase += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - phase_start_).count());
+            phase_start_ = now;
+        }
+    }
+
+    // Счётчики выполняемого на этом потоке запроса или nullptr
+    static QueryStats* Current() noexcept {
+        if constexpr (QUERY_STATS_ENABLED) {
+            return current_;
+        }
+        else {
+            return nullptr;
+        }
+    }
+
+private:
+    static thread_local QueryStats* current_;
+
+    QueryStats stats_;
+    QueryStats* out_ = nullptr;
+    bool is_outer_ = false;
+    Clock::time_point phase_start_;
+
+    void Finish();
+};
+
+// Сводка по запросам, завершённым к моменту вызова. Буферы потоков сливаются под их собственными мьютексами
+QueryStatsSummary GetQueryStatsSummary();
+
+void ResetQueryStatsSummary();
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cmath>
+
+// Сведения о слове запроса, из которых ранжировщик один раз на слово готовит свои константы
+struct TermStatistics {
+    int document_count = 0;
+    int document_freq = 0;
+    double average_document_length = 0.0;
+};
+
+// Ранжировщик подставляется параметром шаблона: PrepareTerm вызывается на слово запроса,
+// Score — на каждый постинг, без виртуальных вызовов. term_freq — доля слова среди слов документа.
+// Ранжировщик с USES_DOCUMENT_LENGTH = false получает вместо длины документа 0, и поиск её не читает
+struct TfIdfRanker {
+    static constexpr bool USES_DOCUMENT_LENGTH = false;
+
+    struct TermWeight {
+        double inverse_document_freq;
+    };
+
+    TermWeight PrepareTerm(const TermStatistics& statistics) const {
+        return { std::log(statistics.document_count * 1.0 / statistics.document_freq) };
+    }
+
+    double Score(const TermWeight& weight, double term_freq, int /*document_length*/) const {
+        return term_freq * weight.inverse_document_freq;
+    }
+};
+
+struct Bm25Ranker {
+    static constexpr bool USES_DOCUMENT_LENGTH = true;
+
+    double k1 = 1.2;
+    double b = 0.75;
+
+    // Score = idf * (k1 + 1) * tf / (tf + k1 * (1 - b + b * length / avg_length)), где tf — число вхождений.
+    // При tf = term_freq * length числитель и знаменатель делятся на length, и остаётся
+    // numerator * term_freq / (term_freq + length_bias / length + length_slope)
+    struct TermWeight {
+        double numerator;
+        double length_bias;
+        double length_slope;
+    };
+
+    TermWeight PrepareTerm(const TermStatistics& statistics) const {
+        const double inverse_document_freq = std::log(1.0
+            + (statistics.document_count - statistics.document_freq + 0.5) / (statistics.document_freq + 0.5));
+        const double average_length = statistics.average_document_length > 0.0 ? statistics.average_document_length : 1.0;
+        return { inverse_document_freq * (k1 + 1.0), k1 * (1.0 - b), k1 * b / average_length };
+    }
+
+    double Score(const TermWeight& weight, double term_freq, int document_length) const {
+        if (document_length == 0) {
+            return 0.0;
+        }
+        return weight.numerator * term_freq / (term_freq + weight.length_bias / document_length + weight.length_slope);
+    }
+};
+
+// Ранжировщики без USES_DOCUMENT_LENGTH считаются зависящими от длины документа
+template <typename Ranker>
+constexpr bool UsesDocumentLength() {
+    if constexpr (requires { Ranker::USES_DOCUMENT_LENGTH; }) {
+        return Ranker::USES_DOCUMENT_LENGTH;
+    }
+    else {
+        return true;
+    }
+}
@@ -1,25 +1,62 @@
 #include "remove_duplicates.h"
 
+#include <set>
+#include <unordered_map>
+
+namespace RemoveDuplicatesPrivate {
+
+    std::vector<int> CollectDuplicates(const SearchServer& search_server, const std::vector<int>& document_ids,
+        const std::vector<WordSetFingerprint>& fingerprints) {
+        // Отпечаток -> документы с различными множествами слов, у которых он совпал
+        std::unordered_map<WordSetFingerprint, std::vector<int>, WordSetFingerprintHasher> originals;
+        originals.reserve(document_ids.size());
+        std::vector<int> duplicate_ids;
+
+        for (size_t i = 0; i < document_ids.size(); ++i) {
+            const int document_id = document_ids[i];
+            auto& candidates = originals[fingerprints[i]];
+            const auto& term_ids = search_server.GetDocumentTermIds(document_id);
+            const bool is_duplicate = std::any_of(candidates.begin(), candidates.end(), [&](int original_id) {
+                return search_server.GetDocumentTermIds(original_id) == term_ids;
+                });
+            if (is_duplicate) {
+                duplicate_ids.push_back(document_id);
+            }
+            else {
+                candidates.push_back(document_id);
+            }
+        }
+        return duplicate_ids;
+    }
+
+}  // namespace RemoveDuplicatesPrivate
+
+std::vector<int> FindDuplicates(const SearchServer& search_server) {
+    return FindDuplicates(std::execution::seq, search_server);
+}
+
 void RemoveDuplicates(SearchServer& search_server) {
-	std::set<std::set<std::string>, int> doc_words;
-	std::vector<int> duplicate_ids;
-
-	for (auto document_id : search_server) {
-		auto word_freqs = search_server.GetWordFrequencies(document_id);
-		std::set<std::string> words;
-		std::transform(word_freqs.cbegin(), word_freqs.cend(),
-			std::inserter(words, words.begin()), [](const std::pair<std::string, double>& elements) {
-				return elements.first;
-			});
-
-		auto [word, emplaced] = doc_words.emplace(words);
-		if (!emplaced) {
-			duplicate_ids.push_back(document_id);
-		}
-	}
-
-	for (auto document_id : duplicate_ids) {
-		std::cout << "Found duplicate document id "s << document_id << std::endl;
-		search_server.RemoveDocument(document_id);
-	}
-}
\ No newline at end of file
+    RemoveDuplicates(std::execution::seq, search_server);
+}
+
+void RemoveNearDuplicates(SearchServer& search_server, NearDuplicateOptions options) {
+    search_server.EnableNearDuplicateDetection(options);
+    std::set<int> kept_ids;
+    std::vector<int> duplicate_ids;
+    for (const int document_id : search_server) {
+        const auto near_duplicates = search_server.FindNearDuplicates(document_id);
+        const bool is_duplicate = std::any_of(near_duplicates.begin(), near_duplicates.end(), [&kept_ids](int id) {
+            return kept_ids.count(id) > 0;
+            });
+        if (is_duplicate) {
+            duplicate_ids.push_back(document_id);
+        }
+        else {
+            kept_ids.insert(document_id);
+        }
+    }
+    for (const int document_id : duplicate_ids) {
+        std::cout << "Found near duplicate document id "s << document_id << std::endl;
+        search_server.RemoveDocument(document_id);
+    }
+}
@@ -1,5 +1,42 @@
 #pragma once
 
+#include <algorithm>
+#include <execution>
+#include <vector>
+
+#include "fingerprint.h"
 #include "search_server.h"
 
-void RemoveDuplicates(SearchServer& search_server);
\ No newline at end of file
+namespace RemoveDuplicatesPrivate {
+
+    std::vector<int> CollectDuplicates(const SearchServer& search_server, const std::vector<int>& document_ids,
+        const std::vector<WordSetFingerprint>& fingerprints);
+
+}  // namespace RemoveDuplicatesPrivate
+
+// Id документов, чьё множество слов совпадает с множеством документа с меньшим id
+template <typename ExecutionPolicy>
+std::vector<int> FindDuplicates(ExecutionPolicy&& policy, const SearchServer& search_server) {
+    const std::vector<int> document_ids(search_server.begin(), search_server.end());
+    std::vector<WordSetFingerprint> fingerprints(document_ids.size());
+    std::transform(policy, document_ids.begin(), document_ids.end(), fingerprints.begin(), [&search_server](int document_id) {
+        return ComputeWordSetFingerprint(search_server.GetDocumentTermIds(document_id));
+        });
+    return RemoveDuplicatesPrivate::CollectDuplicates(search_server, document_ids, fingerprints);
+}
+
+std::vector<int> FindDuplicates(const SearchServer& search_server);
+
+template <typename ExecutionPolicy>
+void RemoveDuplicates(ExecutionPolicy&& policy, SearchServer& search_server) {
+    for (const int document_id : FindDuplicates(policy, search_server)) {
+        std::cout << "Found duplicate document id "s << document_id << std::endl;
+        search_server.RemoveDocument(document_id);
+    }
+}
+
+void RemoveDuplicates(SearchServer& search_server);
+
+// Удаляет документы, похожие на документ с меньшим id не меньше, чем на порог из NearDuplicateOptions.
+// Включает поиск почти дубликатов, если он не включён или включён с другими настройками
+void RemoveNearDuplicates(SearchServer& search_server, NearDuplicateOptions options = {});
@@ -16,12 +16,18 @@ std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query)
     return AddFindRequest(raw_query, DocumentStatus::ACTUAL);
 }
 
+SearchTask<std::vector<Document>> RequestQueue::AddFindRequestAsync(QueryExecutor& executor, std::string raw_query,
+    DocumentStatus status, AsyncQueryOptions options) {
+    return AddFindRequestAsync(executor, std::move(raw_query), DocumentFilter{ status }, std::move(options));
+}
 
 int RequestQueue::GetNoResultRequests() const {
+    std::lock_guard guard(requests_mutex_);
     return no_results_requests_;
 }
 
 void RequestQueue::AddRequest(int results_num) {
+    std::lock_guard guard(requests_mutex_);
     // новый запрос - новая секунда
     ++current_time_;
     // удаляем все результаты поиска, которые устарели
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <deque>
+#include <mutex>
 
 #include "search_server.h"
 #include "document.h"
@@ -15,6 +16,13 @@ public:
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatus status);
     std::vector<Document> AddFindRequest(const std::string& raw_query);
 
+    template <typename DocumentPredicate>
+    SearchTask<std::vector<Document>> AddFindRequestAsync(QueryExecutor& executor, std::string raw_query,
+        DocumentPredicate document_predicate, AsyncQueryOptions options = {});
+
+    SearchTask<std::vector<Document>> AddFindRequestAsync(QueryExecutor& executor, std::string raw_query,
+        DocumentStatus status = DocumentStatus::ACTUAL, AsyncQueryOptions options = {});
+
     int GetNoResultRequests() const;
 
 private:
@@ -28,6 +36,8 @@ private:
     const SearchServer& search_server_;
     int no_results_requests_;
     uint64_t current_time_;
+    // Асинхронные запросы завершаются на потоках пула
+    mutable std::mutex requests_mutex_;
 
     void AddRequest(int results_num);
 };
@@ -37,4 +47,12 @@ std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query,
     const auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
     AddRequest(result.size());
     return result;
+}
+
+template <typename DocumentPredicate>
+SearchTask<std::vector<Document>> RequestQueue::AddFindRequestAsync(QueryExecutor& executor, std::string raw_query,
+    DocumentPredicate document_predicate, AsyncQueryOptions options) {
+    auto result = co_await search_server_.FindTopDocumentsAsync(executor, std::move(raw_query), document_predicate, std::move(options));
+    AddRequest(result.size());
+    co_return result;
 }
\ No newline at end of file
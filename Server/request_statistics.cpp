@@ -0,0 +1,116 @@
+#include "request_statistics.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace {
+
+std::atomic<uint64_t> next_instance_id = 1;
+
+// Счётчик меняет только поток-владелец кольца, поэтому атомарное чтение-запись не нужно
+void Increment(std::atomic<uint64_t>& counter) noexcept {
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+} // namespace
+
+RequestStatistics::RequestStatistics(std::chrono::seconds window)
+    : instance_id_(next_instance_id.fetch_add(1, std::memory_order_relaxed))
+    , window_seconds_(std::max<int64_t>(window.count(), 1))
+    , start_second_(GetCurrentSecond()) {
+}
+
+void RequestStatistics::Record(size_t result_count, Clock::duration latency) {
+    const int64_t now = GetCurrentSecond();
+    Slot& slot = GetThreadRing().slots[static_cast<size_t>(now % window_seconds_)];
+
+    if (slot.second.load(std::memory_order_relaxed) != now) {
+        // Слот остался от прошлого круга. Новая секунда публикуется после обнуления,
+        // и читатель, увидевший её, не увидит старых счётчиков
+        slot.requests.store(0, std::memory_order_relaxed);
+        slot.no_result_requests.store(0, std::memory_order_relaxed);
+        for (auto& bucket : slot.latency_buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        slot.second.store(now, std::memory_order_release);
+    }
+
+    Increment(slot.requests);
+    if (result_count == 0) {
+        Increment(slot.no_result_requests);
+    }
+    const auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+    // Корзина i хранит задержки из [2^(i-1), 2^i) микросекунд
+    const size_t bucket = std::min<size_t>(std::bit_width(static_cast<uint64_t>(std::max<int64_t>(microseconds, 0))),
+        LATENCY_BUCKET_COUNT - 1);
+    Increment(slot.latency_buckets[bucket]);
+}
+
+RequestStatisticsSnapshot RequestStatistics::GetSnapshot() const {
+    const int64_t now = GetCurrentSecond();
+    RequestStatisticsSnapshot snapshot;
+    std::lock_guard guard(rings_mutex_);
+    for (const auto& ring : rings_) {
+        for (const auto& slot : ring.slots) {
+            const int64_t slot_second = slot.second.load(std::memory_order_acquire);
+            if (slot_second <= now - window_seconds_ || slot_second > now) {
+                continue;
+            }
+            snapshot.request_count += slot.requests.load(std::memory_order_relaxed);
+            snapshot.no_result_count += slot.no_result_requests.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < LATENCY_BUCKET_COUNT; ++i) {
+                if (const uint64_t count = slot.latency_buckets[i].load(std::memory_order_relaxed)) {
+                    snapshot.latency.Add(i == 0 ? 0 : (uint64_t{ 1 } << i) - 1, count);
+                }
+            }
+        }
+    }
+    if (snapshot.request_count > 0) {
+        snapshot.empty_result_rate = static_cast<double>(snapshot.no_result_count) / snapshot.request_count;
+    }
+    const int64_t covered_seconds = std::min(window_seconds_, now - start_second_ + 1);
+    snapshot.queries_per_second = static_cast<double>(snapshot.request_count) / covered_seconds;
+    return snapshot;
+}
+
+int64_t RequestStatistics::GetCurrentSecond() noexcept {
+    return std::chrono::duration_cast<std::chrono::seconds>(Clock::now().time_since_epoch()).count();
+}
+
+RequestStatistics::Ring& RequestStatistics::GetThreadRing() {
+    // Обычно поток пишет в одну статистику, и кольцо находится без блокировки
+    thread_local uint64_t cached_instance_id = 0;
+    thread_local Ring* cached_ring = nullptr;
+    if (cached_instance_id == instance_id_) {
+        return *cached_ring;
+    }
+    std::lock_guard guard(rings_mutex_);
+    auto [thread_ring, inserted] = thread_rings_.try_emplace(std::this_thread::get_id(), nullptr);
+    if (inserted) {
+        thread_ring->second = &rings_.emplace_back(static_cast<size_t>(window_seconds_));
+    }
+    cached_instance_id = instance_id_;
+    cached_ring = thread_ring->second;
+    return *cached_ring;
+}
+
+ConcurrentRequestQueue::ConcurrentRequestQueue(const SearchServer& search_server, std::chrono::seconds window)
+    : search_server_(search_server)
+    , statistics_(window) {
+}
+
+std::vector<Document> ConcurrentRequestQueue::AddFindRequest(std::string_view raw_query, DocumentStatus status) {
+    return AddFindRequest(raw_query, DocumentFilter{ status });
+}
+
+std::vector<Document> ConcurrentRequestQueue::AddFindRequest(std::string_view raw_query) {
+    return AddFindRequest(raw_query, DocumentStatus::ACTUAL);
+}
+
+int ConcurrentRequestQueue::GetNoResultRequests() const {
+    return static_cast<int>(statistics_.GetSnapshot().no_result_count);
+}
+
+RequestStatisticsSnapshot ConcurrentRequestQueue::GetStatistics() const {
+    return statistics_.GetSnapshot();
+}
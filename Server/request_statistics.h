@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "document.h"
+#include "histogram.h"
+#include "search_server.h"
+
+struct RequestStatisticsSnapshot {
+    uint64_t request_count = 0;
+    uint64_t no_result_count = 0;
+    double empty_result_rate = 0.0;
+    double queries_per_second = 0.0;
+    // Задержки в микросекундах, округлённые вверх до 2^i - 1
+    Histogram latency;
+};
+
+// Статистика запросов в скользящем окне реального времени. Каждый поток пишет в своё кольцо
+// посекундных слотов: у слота один писатель, и обнуление слота прошлого круга не теряет чужих записей.
+// Чтение суммирует кольца всех потоков, когда-либо писавших в статистику
+class RequestStatistics {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t LATENCY_BUCKET_COUNT = 32;
+
+    explicit RequestStatistics(std::chrono::seconds window = std::chrono::seconds(60));
+
+    void Record(size_t result_count, Clock::duration latency);
+
+    RequestStatisticsSnapshot GetSnapshot() const;
+
+private:
+    struct Slot {
+        std::atomic<int64_t> second = -1;
+        std::atomic<uint64_t> requests = 0;
+        std::atomic<uint64_t> no_result_requests = 0;
+        std::array<std::atomic<uint64_t>, LATENCY_BUCKET_COUNT> latency_buckets{};
+    };
+
+    struct Ring {
+        std::vector<Slot> slots;
+
+        explicit Ring(size_t slot_count) : slots(slot_count) {}
+    };
+
+    // Отличает объекты статистики в кеше потока: адрес может достаться новому объекту
+    const uint64_t instance_id_;
+    int64_t window_seconds_;
+    int64_t start_second_;
+    // deque не переносит кольца при добавлении, поэтому указатели в кешах потоков остаются верными
+    mutable std::mutex rings_mutex_;
+    std::deque<Ring> rings_;
+    std::unordered_map<std::thread::id, Ring*> thread_rings_;
+
+    static int64_t GetCurrentSecond() noexcept;
+
+    Ring& GetThreadRing();
+};
+
+// Аналог RequestQueue, который можно разделять между потоками запросов
+class ConcurrentRequestQueue {
+public:
+    explicit ConcurrentRequestQueue(const SearchServer& search_server, std::chrono::seconds window = std::chrono::seconds(60));
+
+    template <typename DocumentPredicate>
+    std::vector<Document> AddFindRequest(std::string_view raw_query, DocumentPredicate document_predicate);
+
+    std::vector<Document> AddFindRequest(std::string_view raw_query, DocumentStatus status);
+
+    std::vector<Document> AddFindRequest(std::string_view raw_query);
+
+    int GetNoResultRequests() const;
+
+    RequestStatisticsSnapshot GetStatistics() const;
+
+private:
+    const SearchServer& search_server_;
+    RequestStatistics statistics_;
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> ConcurrentRequestQueue::AddFindRequest(std::string_view raw_query, DocumentPredicate document_predicate) {
+    const auto start_time = RequestStatistics::Clock::now();
+    auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
+    statistics_.Record(result.size(), RequestStatistics::Clock::now() - start_time);
+    return result;
+}
@@ -0,0 +1,107 @@
+#include "scoped_timer.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+// Пишет в буфер только его поток. Мьютекс защищает словарь меток: поток берёт его, лишь добавляя
+// новую метку, а сводка — на время обхода. Сами корзины атомарные
+struct TimerBuffer {
+    std::mutex mutex;
+    std::map<std::string, std::unique_ptr<AtomicHistogram>, std::less<>> histograms;
+};
+
+struct TimerRegistry {
+    std::mutex mutex;
+    // Буфер переживает свой поток, чтобы его замеры остались в сводке
+    std::vector<std::shared_ptr<TimerBuffer>> buffers;
+};
+
+TimerRegistry& GetRegistry() {
+    static TimerRegistry registry;
+    return registry;
+}
+
+TimerBuffer& GetThreadBuffer() {
+    thread_local const std::shared_ptr<TimerBuffer> buffer = [] {
+        auto new_buffer = std::make_shared<TimerBuffer>();
+        TimerRegistry& registry = GetRegistry();
+        std::lock_guard guard(registry.mutex);
+        registry.buffers.push_back(new_buffer);
+        return new_buffer;
+    }();
+    return *buffer;
+}
+
+constexpr double PRINTED_PERCENTILES[] = { 50.0, 90.0, 99.0, 99.9, 100.0 };
+
+}  // namespace
+
+AtomicHistogram& ScopedTimer::GetThreadHistogram(std::string_view label) {
+    TimerBuffer& buffer = GetThreadBuffer();
+    // Словарь меняет только этот поток, поэтому искать в нём можно без блокировки
+    auto histogram = buffer.histograms.find(label);
+    if (histogram == buffer.histograms.end()) {
+        std::lock_guard guard(buffer.mutex);
+        histogram = buffer.histograms.emplace(std::string(label), std::make_unique<AtomicHistogram>()).first;
+    }
+    return *histogram->second;
+}
+
+std::map<std::string, Histogram, std::less<>> GetTimerHistograms() {
+    std::map<std::string, Histogram, std::less<>> result;
+    TimerRegistry& registry = GetRegistry();
+    std::lock_guard registry_guard(registry.mutex);
+    for (const auto& buffer : registry.buffers) {
+        std::lock_guard guard(buffer->mutex);
+        for (const auto& [label, histogram] : buffer->histograms) {
+            histogram->MergeTo(result[label]);
+        }
+    }
+    return result;
+}
+
+void ResetTimerHistograms() {
+    TimerRegistry& registry = GetRegistry();
+    std::lock_guard registry_guard(registry.mutex);
+    for (const auto& buffer : registry.buffers) {
+        std::lock_guard guard(buffer->mutex);
+        for (const auto& [label, histogram] : buffer->histograms) {
+            histogram->Reset();
+        }
+    }
+}
+
+void PrintTimerHistograms(std::ostream& out) {
+    for (const auto& [label, histogram] : GetTimerHistograms()) {
+        out << label << ": count " << histogram.GetCount();
+        for (const double percentile : PRINTED_PERCENTILES) {
+            out << ", p" << percentile << ' ' << histogram.GetPercentile(percentile) << " ns";
+        }
+        out << '\n';
+    }
+    out.flush();
+}
+
+void PrintTimerHistogramsJson(std::ostream& out) {
+    out << '{';
+    bool is_first = true;
+    for (const auto& [label, histogram] : GetTimerHistograms()) {
+        out << (is_first ? "" : ", ") << '"';
+        is_first = false;
+        for (const char c : label) {
+            if (c == '"' || c == '\\') {
+                out << '\\';
+            }
+            out << c;
+        }
+        out << "\": {\"count\": " << histogram.GetCount();
+        for (const double percentile : PRINTED_PERCENTILES) {
+            out << ", \"p" << percentile << "_ns\": " << histogram.GetPercentile(percentile);
+        }
+        out << '}';
+    }
+    out << '}' << std::endl;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <string_view>
+
+#include "histogram.h"
+
+#define SCOPED_TIMER_CONCAT_INTERNAL(X, Y) X##Y
+#define SCOPED_TIMER_CONCAT(X, Y) SCOPED_TIMER_CONCAT_INTERNAL(X, Y)
+// label — строковый литерал. Гистограмма метки ищется один раз на поток для каждого места вызова,
+// поэтому деструктор таймера только добавляет замер и ничего не выделяет
+#define SCOPED_TIMER(label)                                                                             \
+    static thread_local AtomicHistogram& SCOPED_TIMER_CONCAT(scopedTimerHistogram, __LINE__) =        \
+        ScopedTimer::GetThreadHistogram("" label);                                                      \
+    ScopedTimer SCOPED_TIMER_CONCAT(scopedTimer, __LINE__)(SCOPED_TIMER_CONCAT(scopedTimerHistogram, __LINE__))
+
+// Замена LOG_DURATION для горячего пути: время блока в наносекундах попадает в гистограмму
+// своего потока, ничего не печатая. Запись не захватывает общих блокировок,
+// сводка по всем потокам собирается по запросу
+class ScopedTimer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit ScopedTimer(AtomicHistogram& histogram) noexcept
+        : histogram_(histogram) {
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    ~ScopedTimer() {
+        histogram_.Add(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_time_).count()));
+    }
+
+    // Гистограмма метки в буфере текущего потока; создаётся при первом обращении и живёт до конца программы
+    static AtomicHistogram& GetThreadHistogram(std::string_view label);
+
+private:
+    AtomicHistogram& histogram_;
+    const Clock::time_point start_time_ = Clock::now();
+};
+
+// Гистограммы всех потоков, слитые по меткам
+std::map<std::string, Histogram, std::less<>> GetTimerHistograms();
+
+void ResetTimerHistograms();
+
+// Для каждой метки — число замеров и перцентили в наносекундах
+void PrintTimerHistograms(std::ostream& out);
+
+void PrintTimerHistogramsJson(std::ostream& out);
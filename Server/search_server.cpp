@@ -8,11 +8,11 @@ int SearchServer::GetDocumentCount() const {
     return static_cast<int>(documents_.size());
 }
 
-const std::set<int>::const_iterator SearchServer::begin() const noexcept {
+DocumentSet::const_iterator SearchServer::begin() const noexcept {
     return count_documents_.begin();
 }
 
-const std::set<int>::const_iterator SearchServer::end() const noexcept {
+DocumentSet::const_iterator SearchServer::end() const noexcept {
     return count_documents_.end();
 }
 
@@ -23,31 +23,196 @@ void SearchServer::AddDocument(int document_id, const std::string_view& document
     if (!IsValidWord(document)) {
         throw std::invalid_argument("Документ содержит спецсимволы");
     }
+    // Слова сразу переносятся в словарь, поэтому делить можно исходный текст, а не его копию
+    WordStorage folded_words;
+    const auto words = SplitIntoWordsNoStop(document, folded_words);
+    std::optional<int> original_id;
+    if (duplicate_policy_ != DuplicatePolicy::ALLOW) {
+        original_id = FindIndexedDuplicate(words);
+        if (original_id && duplicate_policy_ == DuplicatePolicy::REJECT) {
+            throw std::invalid_argument("Документ дублирует документ с id "s + std::to_string(*original_id));
+        }
+    }
     const std::string document_string{ document };
-    documents_.emplace(document_id, DocumentData{ SearchServer::ComputeAverageRating(ratings), status, document_string });
+    documents_.emplace(document_id, DocumentData{ SearchServer::ComputeAverageRating(ratings), status, document_string,
+        static_cast<int>(words.size()) });
+    total_document_length_ += words.size();
+    status_to_documents_[static_cast<size_t>(status)].Add(document_id);
+    rating_to_documents_[documents_.at(document_id).rating].Add(document_id);
 
-    auto words = SplitIntoWordsNoStop(documents_.at(document_id).text_);
     const double inv_word_count = 1.0 / words.size();
-    for (auto& word : words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        document_to_word_freqs_[document_id][word] += inv_word_count;
+    std::vector<std::string_view> stored_words;
+    stored_words.reserve(words.size());
+    std::vector<int>& term_ids = document_to_term_ids_[document_id];
+    for (const auto word : words) {
+        auto stored_word = word_to_id_.find(word);
+        if (stored_word == word_to_id_.end()) {
+            stored_word = word_to_id_.emplace(word, next_term_id_++).first;
+        }
+        stored_words.push_back(stored_word->first);
+        term_ids.push_back(stored_word->second);
+    }
+
+    std::sort(stored_words.begin(), stored_words.end());
+    auto& word_freqs = document_to_word_freqs_[document_id];
+    for (const auto word : stored_words) {
+        if (!word_freqs.empty() && word_freqs.back().first == word) {
+            word_freqs.back().second += inv_word_count;
+        }
+        else {
+            word_freqs.push_back({ word, inv_word_count });
+        }
+    }
+    word_freqs.shrink_to_fit();
+    for (const auto& [word, term_freq] : word_freqs) {
+        word_to_document_freqs_[word][document_id] = term_freq;
+    }
+
+    std::sort(term_ids.begin(), term_ids.end());
+    term_ids.erase(std::unique(term_ids.begin(), term_ids.end()), term_ids.end());
+    if (near_duplicates_) {
+        near_duplicates_->Add(document_id, term_ids);
+    }
+    if (positional_index_) {
+        IndexPositions(document_id, document);
+    }
+    if (duplicate_policy_ != DuplicatePolicy::ALLOW) {
+        fingerprint_to_documents_[ComputeWordSetFingerprint(term_ids)].push_back(document_id);
+        if (original_id) {
+            duplicate_of_.emplace(document_id, *original_id);
+        }
+    }
+
+    count_documents_.Add(document_id);
+}
+
+void SearchServer::SetDuplicatePolicy(DuplicatePolicy policy) {
+    if (policy == duplicate_policy_) {
+        return;
+    }
+    duplicate_policy_ = policy;
+    fingerprint_to_documents_.clear();
+    duplicate_of_.clear();
+    if (policy == DuplicatePolicy::ALLOW) {
+        return;
+    }
+    for (const auto& [document_id, term_ids] : document_to_term_ids_) {
+        fingerprint_to_documents_[ComputeWordSetFingerprint(term_ids)].push_back(document_id);
     }
+}
+
+DuplicatePolicy SearchServer::GetDuplicatePolicy() const noexcept {
+    return duplicate_policy_;
+}
 
-    count_documents_.emplace(document_id);
+const std::map<int, int>& SearchServer::GetFlaggedDuplicates() const noexcept {
+    return duplicate_of_;
+}
+
+std::optional<int> SearchServer::FindIndexedDuplicate(const std::vector<std::string_view>& words) const {
+    std::vector<int> term_ids;
+    term_ids.reserve(words.size());
+    for (const auto word : words) {
+        const auto stored_word = word_to_id_.find(word);
+        if (stored_word == word_to_id_.end()) {
+            // Новое слово: такого множества слов в индексе ещё нет
+            return std::nullopt;
+        }
+        term_ids.push_back(stored_word->second);
+    }
+    std::sort(term_ids.begin(), term_ids.end());
+    term_ids.erase(std::unique(term_ids.begin(), term_ids.end()), term_ids.end());
+
+    const auto candidates = fingerprint_to_documents_.find(ComputeWordSetFingerprint(term_ids));
+    if (candidates == fingerprint_to_documents_.end()) {
+        return std::nullopt;
+    }
+    for (const int candidate_id : candidates->second) {
+        if (document_to_term_ids_.at(candidate_id) == term_ids) {
+            const auto original = duplicate_of_.find(candidate_id);
+            return original == duplicate_of_.end() ? candidate_id : original->second;
+        }
+    }
+    return std::nullopt;
+}
+
+void SearchServer::UnregisterFingerprint(int document_id) {
+    if (duplicate_policy_ == DuplicatePolicy::ALLOW) {
+        return;
+    }
+    const auto candidates = fingerprint_to_documents_.find(ComputeWordSetFingerprint(GetDocumentTermIds(document_id)));
+    if (candidates != fingerprint_to_documents_.end()) {
+        auto& ids = candidates->second;
+        ids.erase(std::remove(ids.begin(), ids.end(), document_id), ids.end());
+        if (ids.empty()) {
+            fingerprint_to_documents_.erase(candidates);
+        }
+    }
+
+    duplicate_of_.erase(document_id);
+    // Дубликаты удалённого оригинала переходят к наименьшему из них, а он сам перестаёт быть дубликатом
+    std::optional<int> new_original_id;
+    for (auto& [duplicate_id, original_id] : duplicate_of_) {
+        if (original_id != document_id) {
+            continue;
+        }
+        if (!new_original_id) {
+            new_original_id = duplicate_id;
+        }
+        original_id = *new_original_id;
+    }
+    if (new_original_id) {
+        duplicate_of_.erase(*new_original_id);
+    }
 }
 
 
 
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(raw_query,
-        [&status](int document_id, DocumentStatus document_status, int rating)
-        { return document_status == status; });
+    return FindTopDocuments(raw_query, DocumentFilter{ status });
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query) const {
     return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, QueryStats& stats) const {
+    return FindTopDocuments(std::execution::seq, raw_query,
+        DocumentFilter{ DocumentStatus::ACTUAL },
+        TfIdfRanker{}, stats);
+}
+
+SearchPage SearchServer::FindTopDocumentsPage(std::string_view raw_query, size_t page_size,
+    const std::optional<SearchCursor>& after) const {
+    return FindTopDocumentsPage(std::execution::seq, raw_query,
+        DocumentFilter{ DocumentStatus::ACTUAL },
+        page_size, after);
+}
+
+std::vector<Document> SearchServer::FindTopDocumentsPageByIndex(std::string_view raw_query, size_t page_index, size_t page_size) const {
+    return FindTopDocumentsPageByIndex(std::execution::seq, raw_query,
+        DocumentFilter{ DocumentStatus::ACTUAL },
+        page_index, page_size);
+}
+
+SearchResult SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status, const QueryBudget& budget) const {
+    return FindTopDocuments(raw_query, DocumentFilter{ status }, budget);
+}
+
+SearchResult SearchServer::FindTopDocuments(std::string_view raw_query, const QueryBudget& budget) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL, budget);
+}
+
+SearchTask<std::vector<Document>> SearchServer::FindTopDocumentsAsync(QueryExecutor& executor, std::string raw_query,
+    DocumentStatus status, AsyncQueryOptions options) const {
+    return FindTopDocumentsAsync(executor, std::move(raw_query), DocumentFilter{ status }, std::move(options));
+}
+
+SearchTask<std::vector<Document>> SearchServer::FindTopDocumentsAsync(QueryExecutor& executor, std::string raw_query,
+    AsyncQueryOptions options) const {
+    return FindTopDocumentsAsync(executor, std::move(raw_query), DocumentStatus::ACTUAL, std::move(options));
+}
+
 using match_tuple = std::tuple<std::vector<std::string_view>, DocumentStatus>;
 
 match_tuple SearchServer::MatchDocument(const std::string_view& raw_query, int document_id) const {
@@ -57,15 +222,22 @@ match_tuple SearchServer::MatchDocument(const std::string_view& raw_query, int d
 match_tuple SearchServer::MatchDocument(const std::execution::sequenced_policy&, const std::string_view& raw_query, int document_id) const {
     std::vector<std::string_view> match_words;
     Query query = ParseQuery(raw_query);
+    if (!ContainsPhrases(ResolvePhrases(query), document_id) || !SatisfiesConstraint(query, document_id)) {
+        return { match_words, documents_.at(document_id).status };
+    }
+    if (PrefersForwardMatch(query, document_id)) {
+        return MatchDocumentByTermIds(query, document_id);
+    }
     for (const auto& minus : query.minus_words) {
         if ((!word_to_document_freqs_.count(minus) == 0 && word_to_document_freqs_.at(minus).count(document_id))) {
-            match_words.clear();
-            return { {} , documents_.at(document_id).status };
+            return { match_words, documents_.at(document_id).status };
         }
     }
     for (const auto& plus : query.plus_words) {
-        if (!word_to_document_freqs_.count(plus) == 0 && word_to_document_freqs_.at(plus).count(document_id)) {
-            match_words.push_back(plus);
+        const auto word_freqs = word_to_document_freqs_.find(plus);
+        if (word_freqs != word_to_document_freqs_.end() && word_freqs->second.count(document_id)) {
+            // Слово запроса может лежать в самом запросе, поэтому возвращается слово индекса
+            match_words.push_back(word_freqs->first);
         }
     }
     return { match_words, documents_.at(document_id).status };
@@ -75,6 +247,12 @@ match_tuple SearchServer::MatchDocument(const std::execution::sequenced_policy&,
 match_tuple SearchServer::MatchDocument(const std::execution::parallel_policy&, const std::string_view& raw_query, int document_id) const {
     std::vector<std::string_view> match_words;
     Query query = ParseQuery(raw_query, true);
+    if (!ContainsPhrases(ResolvePhrases(query), document_id) || !SatisfiesConstraint(query, document_id)) {
+        return { match_words, documents_.at(document_id).status };
+    }
+    if (PrefersForwardMatch(query, document_id)) {
+        return MatchDocumentByTermIds(query, document_id);
+    }
     if (any_of(query.minus_words.begin(), query.minus_words.end(), [&](auto& minus) {return (word_to_document_freqs_.count(minus) > 0 &&
         word_to_document_freqs_.at(minus).count(document_id) > 0); })) {
         return { match_words, documents_.at(document_id).status };
@@ -84,6 +262,9 @@ match_tuple SearchServer::MatchDocument(const std::execution::parallel_policy&,
         [&](auto& plus)
         {return (word_to_document_freqs_.count(plus) > 0 && word_to_document_freqs_.at(plus).count(document_id) > 0); });
     match_words.erase(it, match_words.end());
+    std::transform(match_words.begin(), match_words.end(), match_words.begin(), [&](std::string_view plus) {
+        return word_to_document_freqs_.find(plus)->first;
+        });
 
     std::sort( match_words.begin(), match_words.end());
     const auto& itr = std::unique( match_words.begin(), match_words.end());
@@ -92,6 +273,129 @@ match_tuple SearchServer::MatchDocument(const std::execution::parallel_policy&,
 
 }
 
+bool SearchServer::PrefersForwardMatch(const Query& query, int document_id) const {
+    // Проверка по спискам документов стоит около log2(N) шагов на слово запроса,
+    // слияние с отсортированными id слов документа — один проход по обоим массивам
+    const size_t query_size = query.plus_words.size() + query.minus_words.size();
+    const size_t document_size = GetDocumentTermIds(document_id).size();
+    const auto probe_cost = static_cast<size_t>(std::log2(count_documents_.size() + 1.0) + 1);
+    return document_size + query_size <= query_size * probe_cost;
+}
+
+match_tuple SearchServer::MatchDocumentByTermIds(const Query& query, int document_id) const {
+    const DocumentStatus status = documents_.at(document_id).status;
+    const auto& document_term_ids = GetDocumentTermIds(document_id);
+    const auto to_term_ids = [this](const std::vector<std::string_view>& words) {
+        std::vector<std::pair<int, std::string_view>> term_ids;
+        for (const auto word : words) {
+            const auto stored_word = word_to_id_.find(word);
+            if (stored_word != word_to_id_.end()) {
+                term_ids.push_back({ stored_word->second, stored_word->first });
+            }
+        }
+        std::sort(term_ids.begin(), term_ids.end());
+        return term_ids;
+    };
+    const auto for_each_common = [&document_term_ids](const std::vector<std::pair<int, std::string_view>>& query_term_ids, auto action) {
+        auto document_term = document_term_ids.begin();
+        for (const auto& [term_id, word] : query_term_ids) {
+            document_term = std::lower_bound(document_term, document_term_ids.end(), term_id);
+            if (document_term == document_term_ids.end()) {
+                return;
+            }
+            if (*document_term == term_id) {
+                action(word);
+            }
+        }
+    };
+
+    bool is_excluded = false;
+    for_each_common(to_term_ids(query.minus_words), [&is_excluded](std::string_view) { is_excluded = true; });
+    std::vector<std::string_view> match_words;
+    if (is_excluded) {
+        return { match_words, status };
+    }
+    for_each_common(to_term_ids(query.plus_words), [&match_words](std::string_view word) { match_words.push_back(word); });
+    std::sort(match_words.begin(), match_words.end());
+    match_words.erase(std::unique(match_words.begin(), match_words.end()), match_words.end());
+    return { match_words, status };
+}
+
+std::vector<match_tuple> SearchServer::MatchDocuments(std::string_view raw_query, std::span<const int> document_ids) const {
+    return MatchDocumentBatch(std::execution::seq, raw_query, document_ids);
+}
+
+std::vector<match_tuple> SearchServer::MatchDocuments(const std::execution::sequenced_policy&, std::string_view raw_query,
+    std::span<const int> document_ids) const {
+    return MatchDocumentBatch(std::execution::seq, raw_query, document_ids);
+}
+
+std::vector<match_tuple> SearchServer::MatchDocuments(const std::execution::parallel_policy&, std::string_view raw_query,
+    std::span<const int> document_ids) const {
+    return MatchDocumentBatch(std::execution::par, raw_query, document_ids);
+}
+
+void SearchServer::MarkPostingHits(const std::map<int, double>& word_freqs, const std::vector<int>& sorted_ids, std::vector<char>& hits) {
+    // Короткую пачку выгоднее искать в дереве, длинную — пройти вместе со списком документов слиянием
+    if (sorted_ids.size() * 8 < word_freqs.size()) {
+        for (size_t i = 0; i < sorted_ids.size(); ++i) {
+            hits[i] = word_freqs.count(sorted_ids[i]) > 0;
+        }
+        return;
+    }
+    auto posting = word_freqs.begin();
+    for (size_t i = 0; i < sorted_ids.size() && posting != word_freqs.end(); ++i) {
+        while (posting != word_freqs.end() && posting->first < sorted_ids[i]) {
+            ++posting;
+        }
+        hits[i] = posting != word_freqs.end() && posting->first == sorted_ids[i];
+    }
+}
+
+SearchTask<match_tuple> SearchServer::MatchDocumentAsync(QueryExecutor& executor, std::string raw_query, int document_id,
+    AsyncQueryOptions options) const {
+    co_await executor.Schedule();
+    options.ThrowIfCancelled();
+    const Query query = ParseQuery(raw_query);
+    const DocumentStatus status = documents_.at(document_id).status;
+    if (!ContainsPhrases(ResolvePhrases(query), document_id) || !SatisfiesConstraint(query, document_id)) {
+        co_return match_tuple{ std::vector<std::string_view>{}, status };
+    }
+    // Один проход по словам документа, его не дробим
+    if (PrefersForwardMatch(query, document_id)) {
+        co_return MatchDocumentByTermIds(query, document_id);
+    }
+
+    // Как и в FindTopDocumentsAsync, между блоками слов поток достаётся другим запросам
+    size_t checked_words = 0;
+    const auto next_word = [&]() {
+        return ++checked_words % ASYNC_MATCH_WORD_BLOCK == 0;
+    };
+    for (const auto minus : query.minus_words) {
+        if (next_word()) {
+            co_await executor.Schedule();
+            options.ThrowIfCancelled();
+        }
+        const auto word_freqs = word_to_document_freqs_.find(minus);
+        if (word_freqs != word_to_document_freqs_.end() && word_freqs->second.count(document_id) > 0) {
+            co_return match_tuple{ std::vector<std::string_view>{}, status };
+        }
+    }
+    // Найденные слова указывают в словарь, а не в raw_query, и переживают корутину
+    std::vector<std::string_view> match_words;
+    for (const auto plus : query.plus_words) {
+        if (next_word()) {
+            co_await executor.Schedule();
+            options.ThrowIfCancelled();
+        }
+        const auto word_freqs = word_to_document_freqs_.find(plus);
+        if (word_freqs != word_to_document_freqs_.end() && word_freqs->second.count(document_id) > 0) {
+            match_words.push_back(word_freqs->first);
+        }
+    }
+    co_return match_tuple{ std::move(match_words), status };
+}
+
 int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
     int sum = accumulate(ratings.begin(), ratings.end(), 0);
     int size_rating = static_cast<int>(ratings.size());
@@ -101,14 +405,316 @@ int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
     } return static_cast<int> (sum);
 }
 
-const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
-    static const std::map<std::string_view, double> order;
-    if (document_to_word_freqs_.count(document_id) == 0) {
-        return order;
+WordFrequenciesView SearchServer::GetWordFrequencies(int document_id) const {
+    const auto word_freqs = document_to_word_freqs_.find(document_id);
+    if (word_freqs == document_to_word_freqs_.end()) {
+        return {};
     }
-    else {
-        return document_to_word_freqs_.at(document_id);
+    return { word_freqs->second.data(), word_freqs->second.size() };
+}
+
+const std::vector<int>& SearchServer::GetDocumentTermIds(int document_id) const {
+    static const std::vector<int> empty;
+    const auto term_ids = document_to_term_ids_.find(document_id);
+    return term_ids == document_to_term_ids_.end() ? empty : term_ids->second;
+}
+
+int SearchServer::GetDocumentLength(int document_id) const {
+    return documents_.at(document_id).length;
+}
+
+void SearchServer::EnableNearDuplicateDetection(NearDuplicateOptions options) {
+    if (near_duplicates_ && near_duplicates_->GetOptions() == options) {
+        return;
+    }
+    near_duplicates_.emplace(options);
+    for (const auto& [document_id, term_ids] : document_to_term_ids_) {
+        near_duplicates_->Add(document_id, term_ids);
+    }
+}
+
+void SearchServer::EnablePositionalIndex() {
+    if (positional_index_) {
+        return;
+    }
+    positional_index_.emplace();
+    for (const auto& [document_id, document_data] : documents_) {
+        IndexPositions(document_id, document_data.text_);
+    }
+}
+
+void SearchServer::IndexPositions(int document_id, std::string_view text) {
+    std::vector<std::pair<int, uint32_t>> term_positions;
+    uint32_t position = 0;
+    WordStorage folded_words;
+    for (const std::string_view word : tokenizer_.Tokenize(text, folded_words)) {
+        if (!stop_words_.IsStopWord(word)) {
+            term_positions.push_back({ word_to_id_.find(word)->second, position });
+        }
+        ++position;
+    }
+    positional_index_->Add(document_id, std::move(term_positions));
+}
+
+void SearchServer::UnregisterFilterIndexes(int document_id) {
+    const DocumentData& document_data = documents_.at(document_id);
+    status_to_documents_[static_cast<size_t>(document_data.status)].Remove(document_id);
+    const auto rating_documents = rating_to_documents_.find(document_data.rating);
+    rating_documents->second.Remove(document_id);
+    if (rating_documents->second.empty()) {
+        rating_to_documents_.erase(rating_documents);
+    }
+}
+
+void SearchServer::EraseWordIfUnused(std::string_view word) {
+    const auto word_freqs = word_to_document_freqs_.find(word);
+    if (!word_freqs->second.empty()) {
+        return;
+    }
+    word_to_document_freqs_.erase(word_freqs);
+    // word указывает на ключ словаря, поэтому узел ищется до удаления
+    word_to_id_.erase(word_to_id_.find(word));
+}
+
+bool SearchServer::IsTrivialFilter(const DocumentFilter& filter) const {
+    return filter.min_rating == std::numeric_limits<int>::min() && filter.max_rating == std::numeric_limits<int>::max()
+        && (!filter.status || status_to_documents_[static_cast<size_t>(*filter.status)].size() == documents_.size());
+}
+
+DocumentSet SearchServer::CollectDocuments(const std::vector<std::string_view>& words) const {
+    DocumentSet documents;
+    for (const auto word : words) {
+        const auto word_freqs = word_to_document_freqs_.find(word);
+        if (word_freqs == word_to_document_freqs_.end()) {
+            continue;
+        }
+        // Постинги идут по возрастанию id, поэтому множество слова собирается добавлением в конец
+        DocumentSet word_documents;
+        for (const auto& [document_id, _] : word_freqs->second) {
+            word_documents.Add(document_id);
+        }
+        documents |= word_documents;
+    }
+    return documents;
+}
+
+std::vector<Document> SearchServer::CollectMatchedDocuments(const QueryPlan& plan, const Query& query,
+    const std::map<int, double>& document_to_relevance) const {
+    const auto phrases = ResolvePhrases(query);
+    std::vector<int> document_ids;
+    document_ids.reserve(document_to_relevance.size());
+    for (const auto& [document_id, _] : document_to_relevance) {
+        if (!plan.allowed_documents || plan.allowed_documents->Contains(document_id)) {
+            document_ids.push_back(document_id);
+        }
+    }
+    ExcludeDocuments(plan.minus_postings, document_ids);
+
+    std::vector<Document> matched_documents;
+    matched_documents.reserve(document_ids.size());
+    auto relevance = document_to_relevance.begin();
+    for (const int document_id : document_ids) {
+        while (relevance->first < document_id) {
+            ++relevance;
+        }
+        if (ContainsPhrases(phrases, document_id)) {
+            matched_documents.push_back({ document_id, relevance->second, documents_.at(document_id).rating });
+        }
+    }
+    // Считается на вызывающем потоке: текущие счётчики запроса принадлежат ему, а не потокам пула
+    if (QueryStats* stats = QueryStatsScope::Current()) {
+        stats->terms_looked_up += query.plus_words.size() + query.minus_words.size();
+        stats->postings_scanned += plan.posting_count;
+        stats->candidates_scored += document_to_relevance.size();
+        stats->documents_excluded += document_to_relevance.size() - matched_documents.size();
+    }
+    return matched_documents;
+}
+
+SearchServer::ScoringState SearchServer::StartScoring(const QueryPlan& plan) const {
+    ScoringState state;
+    if (plan.strategy == QueryPlan::Strategy::DOCUMENT_AT_A_TIME) {
+        const std::vector<int>& document_ids = plan.document_ids;
+        state.document_data.resize(document_ids.size());
+        std::transform(document_ids.begin(), document_ids.end(), state.document_data.begin(),
+            [this](int document_id) { return &documents_.at(document_id); });
+        state.relevance.resize(document_ids.size());
+        state.is_matched.resize(document_ids.size());
+    }
+    return state;
+}
+
+std::vector<Document> SearchServer::CollectScoredDocuments(const QueryPlan& plan, const Query& query, const ScoringState& state) const {
+    if (plan.strategy == QueryPlan::Strategy::TERM_AT_A_TIME) {
+        return CollectMatchedDocuments(plan, query, state.document_to_relevance);
+    }
+    // Кандидаты документ-за-документом уже прошли фильтр, выражение запроса и минус-слова в PlanQuery
+    const auto phrases = ResolvePhrases(query);
+    std::vector<Document> matched_documents;
+    size_t candidate_count = 0;
+    for (size_t i = 0; i < state.is_matched.size(); ++i) {
+        if (!state.is_matched[i]) {
+            continue;
+        }
+        ++candidate_count;
+        const int document_id = plan.document_ids[i];
+        if (ContainsPhrases(phrases, document_id)) {
+            matched_documents.push_back({ document_id, state.relevance[i], state.document_data[i]->rating });
+        }
+    }
+    if (QueryStats* stats = QueryStatsScope::Current()) {
+        stats->terms_looked_up += query.plus_words.size() + query.minus_words.size();
+        stats->postings_scanned += state.postings_probed;
+        stats->candidates_scored += candidate_count;
+        stats->documents_excluded += candidate_count - matched_documents.size();
+    }
+    return matched_documents;
+}
+
+SearchServer::QueryPlan SearchServer::PlanTerms(const Query& query) const {
+    QueryPlan plan;
+    const auto find_postings = [this](const std::vector<std::string_view>& words, std::vector<QueryPlan::Postings>& postings) {
+        for (const auto word : words) {
+            const auto word_freqs = word_to_document_freqs_.find(word);
+            if (word_freqs != word_to_document_freqs_.end()) {
+                postings.push_back({ word, &word_freqs->second });
+            }
+        }
+        std::stable_sort(postings.begin(), postings.end(), [](const QueryPlan::Postings& lhs, const QueryPlan::Postings& rhs) {
+            return lhs.second->size() < rhs.second->size();
+            });
+    };
+    find_postings(query.plus_words, plan.plus_postings);
+    find_postings(query.minus_words, plan.minus_postings);
+    for (const auto& [_, word_freqs] : plan.plus_postings) {
+        plan.posting_count += word_freqs->size();
+    }
+    if (plan.plus_postings.empty()
+        || (!plan.minus_postings.empty() && plan.minus_postings.back().second->size() == count_documents_.size())) {
+        plan.strategy = QueryPlan::Strategy::EMPTY;
+        return plan;
+    }
+    if (query.constraint) {
+        if (EstimateDocumentCount(*query.constraint) == 0) {
+            plan.strategy = QueryPlan::Strategy::EMPTY;
+            return plan;
+        }
+        plan.allowed_documents = EvaluateQueryNode(*query.constraint);
+        if (plan.allowed_documents->empty()) {
+            plan.strategy = QueryPlan::Strategy::EMPTY;
+        }
+    }
+    return plan;
+}
+
+void SearchServer::ExcludeDocuments(const std::vector<QueryPlan::Postings>& minus_postings, std::vector<int>& document_ids) const {
+    for (const auto& [_, word_freqs] : minus_postings) {
+        if (document_ids.empty()) {
+            return;
+        }
+        // Поиск кандидата в списке стоит около log2 его длины, слияние — проход по всему списку
+        const auto probe_cost = static_cast<size_t>(std::log2(word_freqs->size() + 1.0) + 1);
+        if (document_ids.size() * probe_cost < word_freqs->size()) {
+            std::erase_if(document_ids, [word_freqs](int document_id) { return word_freqs->count(document_id) > 0; });
+            continue;
+        }
+        // Оба списка отсортированы по id, и кандидаты проверяются по порядку
+        auto posting = word_freqs->begin();
+        std::erase_if(document_ids, [word_freqs, &posting](int document_id) {
+            while (posting != word_freqs->end() && posting->first < document_id) {
+                ++posting;
+            }
+            return posting != word_freqs->end() && posting->first == document_id;
+            });
+    }
+}
+
+std::optional<std::vector<int>> SearchServer::SelectFilteredDocuments(const DocumentFilter& filter, size_t max_selected) const {
+    const bool has_rating_bounds = filter.min_rating != std::numeric_limits<int>::min()
+        || filter.max_rating != std::numeric_limits<int>::max();
+    std::vector<int> document_ids;
+    if (filter.status && status_to_documents_[static_cast<size_t>(*filter.status)].size() < max_selected) {
+        const DocumentSet& status_documents = status_to_documents_[static_cast<size_t>(*filter.status)];
+        if (!has_rating_bounds) {
+            return std::vector<int>(status_documents.begin(), status_documents.end());
+        }
+        for (const int document_id : status_documents) {
+            const DocumentData& document_data = documents_.at(document_id);
+            if (filter(document_id, document_data.status, document_data.rating)) {
+                document_ids.push_back(document_id);
+            }
+        }
+        return document_ids;
+    }
+    if (!has_rating_bounds) {
+        return std::nullopt;
+    }
+    const auto first = rating_to_documents_.lower_bound(filter.min_rating);
+    const auto last = rating_to_documents_.upper_bound(filter.max_rating);
+    size_t selected_count = 0;
+    for (auto rating_documents = first; rating_documents != last; ++rating_documents) {
+        selected_count += rating_documents->second.size();
+        if (selected_count >= max_selected) {
+            return std::nullopt;
+        }
+    }
+    DocumentSet selected_documents;
+    for (auto rating_documents = first; rating_documents != last; ++rating_documents) {
+        selected_documents |= rating_documents->second;
+    }
+    if (filter.status) {
+        selected_documents &= status_to_documents_[static_cast<size_t>(*filter.status)];
+    }
+    return std::vector<int>(selected_documents.begin(), selected_documents.end());
+}
+
+std::vector<PositionalIndex::Phrase> SearchServer::ResolvePhrases(const Query& query) const {
+    std::vector<PositionalIndex::Phrase> phrases;
+    if (query.phrases.empty()) {
+        return phrases;
+    }
+    if (!positional_index_) {
+        throw std::invalid_argument("Поиск по фразе требует позиционного индекса"s);
     }
+    for (const auto& query_phrase : query.phrases) {
+        PositionalIndex::Phrase& phrase = phrases.emplace_back();
+        for (const auto& [word, offset] : query_phrase) {
+            const auto stored_word = word_to_id_.find(word);
+            phrase.push_back({ stored_word == word_to_id_.end() ? -1 : stored_word->second, offset });
+        }
+    }
+    return phrases;
+}
+
+bool SearchServer::ContainsPhrases(const std::vector<PositionalIndex::Phrase>& phrases, int document_id) const {
+    return std::all_of(phrases.begin(), phrases.end(), [this, document_id](const PositionalIndex::Phrase& phrase) {
+        return positional_index_->ContainsPhrase(document_id, phrase);
+        });
+}
+
+void SearchServer::EnableFuzzyMatching(FuzzyMatchOptions options) {
+    if (options.max_edits < 1) {
+        throw std::invalid_argument("Допустимое число опечаток должно быть положительным"s);
+    }
+    fuzzy_options_ = options;
+}
+
+std::vector<std::string_view> SearchServer::FindWordsByPrefix(std::string_view prefix, size_t limit) const {
+    return FindTermsByPrefix(word_to_id_, prefix, limit);
+}
+
+std::vector<int> SearchServer::FindNearDuplicates(int document_id) const {
+    std::vector<int> near_duplicates;
+    if (!near_duplicates_) {
+        return near_duplicates;
+    }
+    const auto& term_ids = GetDocumentTermIds(document_id);
+    for (const int candidate_id : near_duplicates_->FindCandidates(document_id)) {
+        if (ComputeJaccard(term_ids, GetDocumentTermIds(candidate_id)) >= near_duplicates_->GetOptions().jaccard_threshold) {
+            near_duplicates.push_back(candidate_id);
+        }
+    }
+    return near_duplicates;
 }
 
 void SearchServer::RemoveDocument(int document_id) {
@@ -116,27 +722,51 @@ void SearchServer::RemoveDocument(int document_id) {
 }
 
 void SearchServer::RemoveDocument(const std::execution::sequenced_policy&, int document_id) {
+    UnregisterFingerprint(document_id);
+    total_document_length_ -= documents_.at(document_id).length;
+    UnregisterFilterIndexes(document_id);
     documents_.erase(document_id);
-    count_documents_.erase(document_id);
-    for (auto [word, __] : document_to_word_freqs_.at(document_id)) {
+    count_documents_.Remove(document_id);
+    for (const auto& [word, __] : document_to_word_freqs_.at(document_id)) {
         word_to_document_freqs_.at(word).erase(document_id);
+        EraseWordIfUnused(word);
     }
     document_to_word_freqs_.erase(document_id);
+    if (positional_index_) {
+        positional_index_->Remove(document_id, document_to_term_ids_.at(document_id));
+    }
+    document_to_term_ids_.erase(document_id);
+    if (near_duplicates_) {
+        near_duplicates_->Remove(document_id);
+    }
 }
 
 void SearchServer::RemoveDocument(const std::execution::parallel_policy&, int document_id) {
-
+    UnregisterFingerprint(document_id);
+    total_document_length_ -= documents_.at(document_id).length;
+    UnregisterFilterIndexes(document_id);
     std::vector<const std::string_view*> result(document_to_word_freqs_.at(document_id).size());
     std::transform(std::execution::par, document_to_word_freqs_.at(document_id).begin(), document_to_word_freqs_.at(document_id).end(), result.begin(), [](const auto& word) {return &word.first; });
     std::for_each(std::execution::par, result.begin(), result.end(), [this, document_id](const auto& word) {word_to_document_freqs_.at(*word).erase(document_id); });
+    // Словари общие для всех слов, поэтому опустевшие слова удаляются последовательно
+    for (const auto word : result) {
+        EraseWordIfUnused(*word);
+    }
     document_to_word_freqs_.erase(document_id);
+    if (positional_index_) {
+        positional_index_->Remove(document_id, document_to_term_ids_.at(document_id));
+    }
+    document_to_term_ids_.erase(document_id);
+    if (near_duplicates_) {
+        near_duplicates_->Remove(document_id);
+    }
     documents_.erase(document_id);
-    count_documents_.erase(document_id);
+    count_documents_.Remove(document_id);
 }
 
-std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text) const {
+std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text, WordStorage& storage) const {
     std::vector<std::string_view> words;
-    for (const std::string_view& word : SplitIntoWordsView(text)) {
+    for (const std::string_view& word : tokenizer_.Tokenize(text, storage)) {
         if (!stop_words_.IsStopWord(word)) {
             words.push_back(word);
         }
@@ -165,21 +795,158 @@ SearchServer::QueryWord  SearchServer::ParseQueryWord(std::string_view text) con
         is_minus = true;
         text = text.substr(1);
     }
-    return queryWord = { text, is_minus, stop_words_.IsStopWord(text) };
+    return queryWord = { text, is_minus };
 }
 
 SearchServer::Query SearchServer::ParseQuery(std::string_view text, const bool& is_match_par) const {
+    Query query = ParseQuery(text, word_to_id_, is_match_par);
+    if (fuzzy_options_) {
+        ExpandFuzzyWords(query, word_to_id_, *fuzzy_options_, [this](std::string_view word) {
+            const auto word_freqs = word_to_document_freqs_.find(word);
+            return word_freqs == word_to_document_freqs_.end() ? 0 : static_cast<int>(word_freqs->second.size());
+            }, is_match_par);
+    }
+    return query;
+}
+
+SearchServer::Query SearchServer::ParseQuery(std::string_view text, const TermDictionary& dictionary, bool is_match_par) const {
     Query query;
-    for (std::string_view word : SplitIntoWordsView(text)) {
-        const QueryWord query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                query.minus_words.push_back(query_word.data);
+    std::vector<QueryToken> tokens;
+    bool has_operators = false;
+    // Фраза начинается словом с открывающей кавычкой и заканчивается словом с закрывающей
+    bool in_phrase = false;
+    QueryPhrase phrase;
+    QueryToken phrase_token;
+    uint32_t phrase_offset = 0;
+    for (std::string_view word : Tokenizer::SplitOnWhitespace(text)) {
+        if (!in_phrase) {
+            if (word == "AND" || word == "OR" || word == "NOT") {
+                tokens.push_back({ word == "AND" ? QueryToken::Type::AND : word == "OR" ? QueryToken::Type::OR : QueryToken::Type::NOT,
+                    {}, false, false, false });
+                has_operators = true;
+                continue;
             }
-            else {
-                query.plus_words.push_back(query_word.data);
+            for (; !word.empty() && word.front() == '('; word.remove_prefix(1)) {
+                tokens.push_back({ QueryToken::Type::OPEN, {}, false, false, false });
+                has_operators = true;
             }
         }
+        // Скобка после слова фразы закрывает группу, только если перед ней закрыта и фраза
+        size_t closing_count = 0;
+        std::string_view unbracketed = word;
+        for (; !unbracketed.empty() && unbracketed.back() == ')'; unbracketed.remove_suffix(1)) {
+            ++closing_count;
+        }
+        if (closing_count > 0 && (!in_phrase || (!unbracketed.empty() && unbracketed.back() == '"'))) {
+            word = unbracketed;
+        }
+        else {
+            closing_count = 0;
+        }
+        bool is_required = false;
+        if (!in_phrase && word.size() > 1 && word.front() == '+') {
+            is_required = true;
+            has_operators = true;
+            word.remove_prefix(1);
+        }
+        if (!in_phrase && !word.empty() && word.front() == '"') {
+            in_phrase = true;
+            phrase.clear();
+            phrase_token = { QueryToken::Type::TERM, {}, true, is_required, false };
+            phrase_offset = 0;
+            word.remove_prefix(1);
+        }
+        const bool closes_phrase = in_phrase && !word.empty() && word.back() == '"';
+        if (closes_phrase) {
+            word.remove_suffix(1);
+        }
+        if (!word.empty()) {
+            const QueryWord query_word = ParseQueryWord(word);
+            const bool is_prefix = query_word.data.back() == '*';
+            if (is_prefix && query_word.data.size() == 1) {
+                throw std::invalid_argument("Запрос содержит некорректные слова"s);
+            }
+            if (in_phrase) {
+                if (is_prefix) {
+                    throw std::invalid_argument("Фраза запроса содержит слово с *"s);
+                }
+                if (query_word.is_minus) {
+                    throw std::invalid_argument("Фраза запроса содержит минус-слово"s);
+                }
+            }
+            // Слово запроса делится и приводится к нижнему регистру так же, как текст документа, и может
+            // распасться на несколько слов индекса: "Foo-bar" ищется как foo bar с теми же + и -
+            const std::string_view body = is_prefix ? query_word.data.substr(0, query_word.data.size() - 1) : query_word.data;
+            const auto normalized_words = tokenizer_.Tokenize(body, query.folded_words);
+            if (normalized_words.empty() && !in_phrase) {
+                // Слово из одних знаков препинания ведёт себя в выражении как стоп-слово
+                tokens.push_back({ QueryToken::Type::TERM, {}, false, is_required, query_word.is_minus });
+            }
+            for (size_t i = 0; i < normalized_words.size(); ++i) {
+                const std::string_view normalized = normalized_words[i];
+                // Префикс раскрывается, даже если сам совпадает со стоп-словом
+                const bool expands_prefix = is_prefix && i + 1 == normalized_words.size();
+                const bool is_stop = !expands_prefix && stop_words_.IsStopWord(normalized);
+                if (in_phrase) {
+                    if (!is_stop) {
+                        phrase.push_back({ normalized, phrase_offset });
+                        phrase_token.words.push_back(normalized);
+                    }
+                    ++phrase_offset;
+                }
+                std::vector<std::string_view> term_words;
+                if (!is_stop) {
+                    if (expands_prefix) {
+                        term_words = FindTermsByPrefix(dictionary, normalized, MAX_PREFIX_EXPANSIONS);
+                    }
+                    else {
+                        term_words.push_back(normalized);
+                    }
+                    if (!query_word.is_minus) {
+                        query.plus_words.insert(query.plus_words.end(), term_words.begin(), term_words.end());
+                    }
+                    else {
+                        query.minus_words.insert(query.minus_words.end(), term_words.begin(), term_words.end());
+                    }
+                }
+                if (!in_phrase) {
+                    tokens.push_back({ QueryToken::Type::TERM, std::move(term_words), false, is_required, query_word.is_minus });
+                }
+            }
+        }
+        if (closes_phrase) {
+            in_phrase = false;
+            // Фраза из одного слова ничего не добавляет к плюс-слову. Длинная фраза входит в выражение
+            // как AND своих слов: позиции проверяются только у документов из пересечения их списков
+            if (phrase.size() > 1) {
+                query.phrases.push_back(std::move(phrase));
+                phrase_token.is_required = true;
+                has_operators = true;
+            }
+            tokens.push_back(std::move(phrase_token));
+        }
+        for (; closing_count > 0; --closing_count) {
+            tokens.push_back({ QueryToken::Type::CLOSE, {}, false, false, false });
+            has_operators = true;
+        }
+    }
+    if (in_phrase) {
+        throw std::invalid_argument("Запрос содержит незакрытую кавычку"s);
+    }
+    if (has_operators) {
+        size_t position = 0;
+        std::vector<std::string_view> scored_words;
+        query.constraint = ParseAnyOf(tokens, position, false, scored_words);
+        if (position != tokens.size()) {
+            throw std::invalid_argument("Запрос содержит непарную скобку"s);
+        }
+        query.plus_words = std::move(scored_words);
+        // Минус-слово в скобках или под NOT исключает документ не из всей выдачи, поэтому общими
+        // минус-словами остаются только слова под NOT на верхнем уровне выражения
+        query.minus_words.clear();
+        if (query.constraint) {
+            CollectExcludedWords(*query.constraint, query.minus_words);
+        }
     }
 
     if (is_match_par == false) {
@@ -194,6 +961,296 @@ SearchServer::Query SearchServer::ParseQuery(std::string_view text, const bool&
     return query;
 }
 
+std::optional<SearchServer::QueryNode> SearchServer::ParseAnyOf(const std::vector<QueryToken>& tokens, size_t& position, bool is_negated,
+    std::vector<std::string_view>& scored_words) {
+    std::vector<QueryNode> must;
+    std::vector<QueryNode> should;
+    std::vector<QueryNode> must_not;
+    bool expects_operand = true;
+    bool is_empty = true;
+    while (position < tokens.size() && tokens[position].type != QueryToken::Type::CLOSE) {
+        if (tokens[position].type == QueryToken::Type::OR) {
+            if (expects_operand) {
+                throw std::invalid_argument("Запрос содержит оператор без операнда"s);
+            }
+            expects_operand = true;
+            ++position;
+            continue;
+        }
+        QueryClause clause = ParseAllOf(tokens, position, is_negated, scored_words);
+        expects_operand = false;
+        is_empty = false;
+        if (!clause.node) {
+            continue;
+        }
+        switch (clause.occurrence) {
+        case QueryClause::Occurrence::MUST:
+            must.push_back(std::move(*clause.node));
+            break;
+        case QueryClause::Occurrence::SHOULD:
+            should.push_back(std::move(*clause.node));
+            break;
+        case QueryClause::Occurrence::MUST_NOT:
+            must_not.push_back(CombineQueryNodes(QueryNode::Operation::NOT, { std::move(*clause.node) }));
+            break;
+        }
+    }
+    if (expects_operand && !is_empty) {
+        throw std::invalid_argument("Запрос содержит оператор без операнда"s);
+    }
+    if (must.empty() && should.empty() && must_not.empty()) {
+        return std::nullopt;
+    }
+    if (must.empty() && !should.empty()) {
+        must.push_back(CombineQueryNodes(QueryNode::Operation::OR, std::move(should)));
+    }
+    std::move(must_not.begin(), must_not.end(), std::back_inserter(must));
+    return CombineQueryNodes(QueryNode::Operation::AND, std::move(must));
+}
+
+SearchServer::QueryClause SearchServer::ParseAllOf(const std::vector<QueryToken>& tokens, size_t& position, bool is_negated,
+    std::vector<std::string_view>& scored_words) {
+    QueryClause clause = ParseOperand(tokens, position, is_negated, scored_words);
+    if (position == tokens.size() || tokens[position].type != QueryToken::Type::AND) {
+        return clause;
+    }
+    std::vector<QueryClause> operands;
+    operands.push_back(std::move(clause));
+    while (position < tokens.size() && tokens[position].type == QueryToken::Type::AND) {
+        ++position;
+        operands.push_back(ParseOperand(tokens, position, is_negated, scored_words));
+    }
+    std::vector<QueryNode> children;
+    for (QueryClause& operand : operands) {
+        if (!operand.node) {
+            continue;
+        }
+        if (operand.occurrence == QueryClause::Occurrence::MUST_NOT) {
+            children.push_back(CombineQueryNodes(QueryNode::Operation::NOT, { std::move(*operand.node) }));
+        }
+        else {
+            children.push_back(std::move(*operand.node));
+        }
+    }
+    if (children.empty()) {
+        return {};
+    }
+    return { CombineQueryNodes(QueryNode::Operation::AND, std::move(children)) };
+}
+
+SearchServer::QueryClause SearchServer::ParseOperand(const std::vector<QueryToken>& tokens, size_t& position, bool is_negated,
+    std::vector<std::string_view>& scored_words) {
+    if (position == tokens.size()) {
+        throw std::invalid_argument("Запрос содержит оператор без операнда"s);
+    }
+    const QueryToken& token = tokens[position++];
+    switch (token.type) {
+    case QueryToken::Type::NOT: {
+        QueryClause clause = ParseOperand(tokens, position, !is_negated, scored_words);
+        clause.occurrence = clause.occurrence == QueryClause::Occurrence::MUST_NOT
+            ? QueryClause::Occurrence::SHOULD : QueryClause::Occurrence::MUST_NOT;
+        return clause;
+    }
+    case QueryToken::Type::OPEN: {
+        QueryClause clause{ ParseAnyOf(tokens, position, is_negated, scored_words) };
+        if (position == tokens.size()) {
+            throw std::invalid_argument("Запрос содержит непарную скобку"s);
+        }
+        ++position;
+        return clause;
+    }
+    case QueryToken::Type::TERM:
+        break;
+    default:
+        throw std::invalid_argument("Запрос содержит оператор без операнда"s);
+    }
+
+    QueryClause clause;
+    clause.occurrence = token.is_excluded ? QueryClause::Occurrence::MUST_NOT
+        : token.is_required ? QueryClause::Occurrence::MUST : QueryClause::Occurrence::SHOULD;
+    if (token.words.empty()) {
+        return clause;
+    }
+    if (is_negated != token.is_excluded) {
+        // Фразы отсеивают документы всей выдачи, поэтому исключить фразу нельзя
+        if (token.is_phrase) {
+            throw std::invalid_argument("Фраза запроса находится под отрицанием"s);
+        }
+    }
+    else {
+        scored_words.insert(scored_words.end(), token.words.begin(), token.words.end());
+    }
+    if (!token.is_phrase) {
+        clause.node = QueryNode{ QueryNode::Operation::TERM, token.words, {} };
+        return clause;
+    }
+    std::vector<QueryNode> children;
+    for (const auto word : token.words) {
+        children.push_back({ QueryNode::Operation::TERM, { word }, {} });
+    }
+    clause.node = CombineQueryNodes(QueryNode::Operation::AND, std::move(children));
+    return clause;
+}
+
+SearchServer::QueryNode SearchServer::CombineQueryNodes(QueryNode::Operation operation, std::vector<QueryNode> children) {
+    if (children.size() == 1 && operation != QueryNode::Operation::NOT) {
+        return std::move(children.front());
+    }
+    return { operation, {}, std::move(children) };
+}
+
+void SearchServer::CollectExcludedWords(const QueryNode& node, std::vector<std::string_view>& words) {
+    const auto collect_negated_term = [&words](const QueryNode& negation) {
+        const QueryNode& operand = negation.children.front();
+        if (operand.operation == QueryNode::Operation::TERM) {
+            words.insert(words.end(), operand.words.begin(), operand.words.end());
+        }
+    };
+    if (node.operation == QueryNode::Operation::NOT) {
+        collect_negated_term(node);
+        return;
+    }
+    if (node.operation != QueryNode::Operation::AND) {
+        return;
+    }
+    for (const QueryNode& child : node.children) {
+        if (child.operation == QueryNode::Operation::NOT) {
+            collect_negated_term(child);
+        }
+    }
+}
+
+void SearchServer::AddTermAlternative(QueryNode& node, std::string_view word, std::string_view alternative) {
+    if (node.operation == QueryNode::Operation::TERM) {
+        if (std::find(node.words.begin(), node.words.end(), word) != node.words.end()
+            && std::find(node.words.begin(), node.words.end(), alternative) == node.words.end()) {
+            node.words.push_back(alternative);
+        }
+        return;
+    }
+    for (QueryNode& child : node.children) {
+        AddTermAlternative(child, word, alternative);
+    }
+}
+
+size_t SearchServer::EstimateDocumentCount(const QueryNode& node) const {
+    switch (node.operation) {
+    case QueryNode::Operation::TERM: {
+        size_t document_count = 0;
+        for (const auto word : node.words) {
+            const auto word_freqs = word_to_document_freqs_.find(word);
+            document_count += word_freqs == word_to_document_freqs_.end() ? 0 : word_freqs->second.size();
+        }
+        return std::min(document_count, count_documents_.size());
+    }
+    case QueryNode::Operation::AND: {
+        size_t document_count = count_documents_.size();
+        for (const QueryNode& child : node.children) {
+            if (child.operation != QueryNode::Operation::NOT) {
+                document_count = std::min(document_count, EstimateDocumentCount(child));
+            }
+        }
+        return document_count;
+    }
+    case QueryNode::Operation::OR: {
+        size_t document_count = 0;
+        for (const QueryNode& child : node.children) {
+            document_count += EstimateDocumentCount(child);
+        }
+        return std::min(document_count, count_documents_.size());
+    }
+    default:
+        return count_documents_.size();
+    }
+}
+
+DocumentSet SearchServer::EvaluateQueryNode(const QueryNode& node) const {
+    switch (node.operation) {
+    case QueryNode::Operation::TERM:
+        return CollectDocuments(node.words);
+    case QueryNode::Operation::OR: {
+        DocumentSet documents;
+        for (const QueryNode& child : node.children) {
+            documents |= EvaluateQueryNode(child);
+        }
+        return documents;
+    }
+    case QueryNode::Operation::NOT:
+        return count_documents_ - EvaluateQueryNode(node.children.front());
+    default:
+        break;
+    }
+
+    std::vector<std::pair<size_t, const QueryNode*>> included;
+    std::vector<std::pair<size_t, const QueryNode*>> excluded;
+    for (const QueryNode& child : node.children) {
+        if (child.operation == QueryNode::Operation::NOT) {
+            excluded.push_back({ EstimateDocumentCount(child.children.front()), &child.children.front() });
+        }
+        else {
+            included.push_back({ EstimateDocumentCount(child), &child });
+        }
+    }
+    std::sort(included.begin(), included.end());
+    DocumentSet documents = included.empty() ? count_documents_ : EvaluateQueryNode(*included.front().second);
+    const auto apply = [this, &documents](size_t document_count, const QueryNode& child, bool is_included) {
+        if (documents.size() < document_count) {
+            DocumentSet matched_documents;
+            for (const int document_id : documents) {
+                if (MatchesQueryNode(child, document_id) == is_included) {
+                    matched_documents.Add(document_id);
+                }
+            }
+            documents = std::move(matched_documents);
+        }
+        else if (is_included) {
+            documents &= EvaluateQueryNode(child);
+        }
+        else {
+            documents -= EvaluateQueryNode(child);
+        }
+    };
+    for (size_t i = 1; i < included.size() && !documents.empty(); ++i) {
+        apply(included[i].first, *included[i].second, true);
+    }
+    for (size_t i = 0; i < excluded.size() && !documents.empty(); ++i) {
+        apply(excluded[i].first, *excluded[i].second, false);
+    }
+    return documents;
+}
+
+bool SearchServer::MatchesQueryNode(const QueryNode& node, int document_id) const {
+    switch (node.operation) {
+    case QueryNode::Operation::TERM:
+        return std::any_of(node.words.begin(), node.words.end(), [this, document_id](std::string_view word) {
+            const auto word_freqs = word_to_document_freqs_.find(word);
+            return word_freqs != word_to_document_freqs_.end() && word_freqs->second.count(document_id) > 0;
+            });
+    case QueryNode::Operation::AND:
+        return std::all_of(node.children.begin(), node.children.end(), [this, document_id](const QueryNode& child) {
+            return MatchesQueryNode(child, document_id);
+            });
+    case QueryNode::Operation::OR:
+        return std::any_of(node.children.begin(), node.children.end(), [this, document_id](const QueryNode& child) {
+            return MatchesQueryNode(child, document_id);
+            });
+    default:
+        return !MatchesQueryNode(node.children.front(), document_id);
+    }
+}
+
+bool SearchServer::SatisfiesConstraint(const Query& query, int document_id) const {
+    return !query.constraint || MatchesQueryNode(*query.constraint, document_id);
+}
+
 double SearchServer::ComputeWordInverseDocumentFreq(const std::string_view& word) const {
     return log(count_documents_.size() * 1.0 / word_to_document_freqs_.at(word).size());
+}
+
+TermStatistics SearchServer::GetTermStatistics(std::string_view word) const {
+    const auto word_freqs = word_to_document_freqs_.find(word);
+    const int document_count = static_cast<int>(count_documents_.size());
+    return { document_count,
+             word_freqs == word_to_document_freqs_.end() ? 0 : static_cast<int>(word_freqs->second.size()),
+             document_count == 0 ? 0.0 : static_cast<double>(total_document_length_) / document_count };
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -12,27 +13,117 @@
 #include <execution>
 #include <string_view>
 #include <type_traits>
+#include <chrono>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <span>
 
 #include "document.h"
+#include "document_set.h"
 #include "string_processing.h"
 #include "concurrent_map.h"
+#include "async_search.h"
+#include "near_duplicates.h"
+#include "fingerprint.h"
+#include "word_frequencies_view.h"
+#include "ranking.h"
+#include "positional_index.h"
+#include "term_dictionary.h"
+#include "query_stats.h"
+#include "scoped_timer.h"
+#include "tokenizer.h"
 using namespace std::string_literals;
 
 constexpr int MAX_RESULT_DOCUMENT_COUNT = 5;
-constexpr double EPSILON = 1e-6;
 constexpr size_t BUCKETS = 16;
+// Сколько постингов асинхронный запрос обрабатывает, прежде чем уступить поток другим запросам
+constexpr size_t ASYNC_POSTING_BLOCK = 4096;
+// Сколько слов запроса асинхронный MatchDocument проверяет между уступками потока
+constexpr size_t ASYNC_MATCH_WORD_BLOCK = 64;
+// Как часто запрос с бюджетом сверяется с часами
+constexpr size_t BUDGET_CLOCK_CHECK_INTERVAL = 1024;
+// Во сколько слов словаря самое большее раскрывается слово запроса с * на конце
+constexpr size_t MAX_PREFIX_EXPANSIONS = 64;
+
+// Ограничение на выполнение одного запроса: время и/или число просмотренных постингов
+struct QueryBudget {
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point deadline = Clock::time_point::max();
+    size_t max_postings = std::numeric_limits<size_t>::max();
+};
+
+struct SearchResult {
+    std::vector<Document> documents;
+    // Бюджет исчерпан раньше, чем были просмотрены все постинги запроса
+    bool is_partial = false;
+};
+
+// Предикат документа, который поиск узнаёт по типу: вместо проверки каждого постинга он
+// берёт документы нужного статуса или диапазона рейтингов из индексов, если их меньше, чем постингов запроса
+struct DocumentFilter {
+    std::optional<DocumentStatus> status;
+    int min_rating = std::numeric_limits<int>::min();
+    int max_rating = std::numeric_limits<int>::max();
+
+    bool operator()(int /*document_id*/, DocumentStatus document_status, int rating) const {
+        return (!status || document_status == *status) && min_rating <= rating && rating <= max_rating;
+    }
+};
+
+// Предикат «любой документ»: с ним поиск не обращается к данным документов
+struct NoDocumentFilter {
+    bool operator()(int /*document_id*/, DocumentStatus /*document_status*/, int /*rating*/) const {
+        return true;
+    }
+};
+
+// Положение последнего документа выданной страницы в порядке IsRankedBefore
+struct SearchCursor {
+    double relevance = 0.0;
+    int rating = 0;
+    int document_id = 0;
+};
+
+struct SearchPage {
+    std::vector<Document> documents;
+    // Курсор для следующей страницы; пусто, если это последняя
+    std::optional<SearchCursor> next_cursor;
+};
+
+// Поиск с опечатками: плюс-слово, встречающееся не более чем в max_document_freq документах,
+// дополняется словами словаря на расстоянии не больше max_edits. Вклад такого слова умножается
+// на edit_penalty в степени расстояния
+struct FuzzyMatchOptions {
+    int max_edits = 2;
+    int max_document_freq = 0;
+    double edit_penalty = 0.5;
+    // Из найденных слов берутся ближайшие, при равном расстоянии — первые по словарю
+    size_t max_expansions = 8;
+};
+
+// Что делать с документом, множество слов которого совпадает с уже проиндексированным
+enum class DuplicatePolicy {
+    ALLOW,
+    REJECT,
+    FLAG
+};
 
 class StopWords {
 public:
 
     StopWords() = default;
 
-    explicit StopWords(const std::string& text) : StopWords(SplitIntoWords(text)) {}
+    explicit StopWords(const std::string& text, const Tokenizer& tokenizer = Tokenizer{})
+        : StopWords(Tokenizer::SplitOnWhitespace(text), tokenizer) {}
 
-    explicit StopWords(const std::string_view& text) : StopWords(SplitIntoWordsView(text)) {}
+    explicit StopWords(const std::string_view& text, const Tokenizer& tokenizer = Tokenizer{})
+        : StopWords(Tokenizer::SplitOnWhitespace(text), tokenizer) {}
 
+    // Стоп-слова проходят через тот же токенизатор, что и документы: "The" совпадает со словом "the"
     template <typename Container>
-    StopWords(const Container& container);
+    StopWords(const Container& container, const Tokenizer& tokenizer = Tokenizer{});
 
 
     bool IsStopWord(const std::string_view& word) const;
@@ -48,13 +139,14 @@ public:
     SearchServer() = default;
 
     template <typename StringCollection>
-    explicit SearchServer(const StringCollection& stop_words = ""s) :stop_words_(stop_words) {}
+    explicit SearchServer(const StringCollection& stop_words = ""s, TokenizerOptions tokenizer_options = {})
+        : tokenizer_(tokenizer_options), stop_words_(stop_words, tokenizer_) {}
 
     int GetDocumentCount() const;
 
-    const std::set<int>::const_iterator begin() const noexcept;
+    DocumentSet::const_iterator begin() const noexcept;
 
-    const std::set<int>::const_iterator end() const noexcept;
+    DocumentSet::const_iterator end() const noexcept;
 
     void AddDocument(int document_id, const std::string_view& document, const DocumentStatus status, const std::vector<int>& ratings);
 
@@ -66,15 +158,68 @@ public:
 
     std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
 
+    // Счётчики запроса попадают в stats, только если сборка включает SEARCH_SERVER_QUERY_STATS, иначе там нули
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, QueryStats& stats) const;
+
+    // Слова обрабатываются от редких к частым, чтобы при обрыве по бюджету в результат успели попасть самые информативные
+    template <typename DocumentPredicate>
+    SearchResult FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, const QueryBudget& budget) const;
+
+    template <typename DocumentPredicate, typename Ranker>
+    SearchResult FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, const QueryBudget& budget,
+        const Ranker& ranker) const;
+
+    SearchResult FindTopDocuments(std::string_view raw_query, DocumentStatus status, const QueryBudget& budget) const;
+
+    SearchResult FindTopDocuments(std::string_view raw_query, const QueryBudget& budget) const;
+
     template <typename DocumentPredicate, typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query,
         DocumentPredicate document_predicate) const;
+
+    // Ранжировщик выбирается на этапе компиляции, см. ranking.h; без него используется TfIdfRanker
+    template <typename DocumentPredicate, typename ExecutionPolicy, typename Ranker>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query,
+        DocumentPredicate document_predicate, const Ranker& ranker) const;
+
+    template <typename DocumentPredicate, typename ExecutionPolicy, typename Ranker>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query,
+        DocumentPredicate document_predicate, const Ranker& ranker, QueryStats& stats) const;
+
+    // Страница из page_size документов, идущих после after. Сортируется не весь набор найденных
+    // документов, а только выбранная страница. Курсор верен, пока индекс не менялся
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    SearchPage FindTopDocumentsPage(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate,
+        size_t page_size, const std::optional<SearchCursor>& after = std::nullopt) const;
+
+    SearchPage FindTopDocumentsPage(std::string_view raw_query, size_t page_size,
+        const std::optional<SearchCursor>& after = std::nullopt) const;
+
+    // Страница с номером page_index, считая с нуля, без курсора: упорядочиваются только первые
+    // (page_index + 1) * page_size документов
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsPageByIndex(ExecutionPolicy&& policy, std::string_view raw_query,
+        DocumentPredicate document_predicate, size_t page_index, size_t page_size) const;
+
+    std::vector<Document> FindTopDocumentsPageByIndex(std::string_view raw_query, size_t page_index, size_t page_size) const;
+
     template <typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status) const;
 
     template <typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query) const;
 
+    // Асинхронные версии владеют текстом запроса: корутина может пережить строку вызывающего
+    template <typename DocumentPredicate>
+    SearchTask<std::vector<Document>> FindTopDocumentsAsync(QueryExecutor& executor, std::string raw_query,
+        DocumentPredicate document_predicate, AsyncQueryOptions options = {}) const;
+
+    SearchTask<std::vector<Document>> FindTopDocumentsAsync(QueryExecutor& executor, std::string raw_query,
+        DocumentStatus status, AsyncQueryOptions options = {}) const;
+
+    SearchTask<std::vector<Document>> FindTopDocumentsAsync(QueryExecutor& executor, std::string raw_query,
+        AsyncQueryOptions options = {}) const;
+
     using match_tuple = std::tuple<std::vector<std::string_view>, DocumentStatus>;
 
     match_tuple MatchDocument(const std::string_view& raw_query, int document_id) const;
@@ -83,7 +228,52 @@ public:
 
     match_tuple MatchDocument(const std::execution::parallel_policy&, const std::string_view& raw_query, int document_id) const;
 
-    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    // Запрос разбирается один раз, каждое слово пересекает свой список документов с отсортированной пачкой id.
+    // Результаты идут в порядке document_ids, слова указывают в индекс сервера
+    std::vector<match_tuple> MatchDocuments(std::string_view raw_query, std::span<const int> document_ids) const;
+
+    std::vector<match_tuple> MatchDocuments(const std::execution::sequenced_policy&, std::string_view raw_query,
+        std::span<const int> document_ids) const;
+
+    std::vector<match_tuple> MatchDocuments(const std::execution::parallel_policy&, std::string_view raw_query,
+        std::span<const int> document_ids) const;
+
+    // Слова результата указывают во владеющий индекс сервера, а не в текст запроса
+    SearchTask<match_tuple> MatchDocumentAsync(QueryExecutor& executor, std::string raw_query, int document_id,
+        AsyncQueryOptions options = {}) const;
+
+    WordFrequenciesView GetWordFrequencies(int document_id) const;
+
+    const std::vector<int>& GetDocumentTermIds(int document_id) const;
+
+    // Число слов документа без стоп-слов; для неизвестного id бросает std::out_of_range
+    int GetDocumentLength(int document_id) const;
+
+    // REJECT и FLAG поддерживают индекс отпечатков множеств слов, и AddDocument проверяет документ до индексации:
+    // REJECT бросает исключение, FLAG индексирует документ и запоминает, дубликатом какого документа он оказался
+    void SetDuplicatePolicy(DuplicatePolicy policy);
+
+    DuplicatePolicy GetDuplicatePolicy() const noexcept;
+
+    // Id дубликата -> id оригинала для документов, отмеченных в режиме FLAG
+    const std::map<int, int>& GetFlaggedDuplicates() const noexcept;
+
+    // Включает MinHash-сигнатуры: уже добавленные документы индексируются сразу, новые — в AddDocument.
+    // Если поиск уже включён с теми же настройками, индекс не перестраивается
+    void EnableNearDuplicateDetection(NearDuplicateOptions options = {});
+
+    // Документы, чья мера Жаккара с данным не ниже порога; пусто, если поиск почти дубликатов не включён
+    std::vector<int> FindNearDuplicates(int document_id) const;
+
+    void EnableFuzzyMatching(FuzzyMatchOptions options = {});
+
+    // Слова индекса с данным префиксом в лексикографическом порядке, не больше limit — для автодополнения
+    std::vector<std::string_view> FindWordsByPrefix(std::string_view prefix,
+        size_t limit = std::numeric_limits<size_t>::max()) const;
+
+    // Включает позиции слов, нужные для фраз в кавычках ("big dog"): уже добавленные документы
+    // индексируются сразу, новые — в AddDocument. Без позиционного индекса запрос с фразой отклоняется
+    void EnablePositionalIndex();
 
     void RemoveDocument(int document_id);
 
@@ -92,41 +282,299 @@ public:
     void RemoveDocument(const std::execution::parallel_policy&, int document_id);
 
 private:
+    friend class ShardedSearchServer;
+
     struct DocumentData {
         int rating;
         DocumentStatus status;
         std::string text_;
+        // Число слов документа без стоп-слов
+        int length = 0;
     };
 
     struct QueryWord {
         std::string_view data;
         bool is_minus;
-        bool is_stop;
+    };
+
+    // Слова фразы без стоп-слов и их смещения от начала фразы с учётом стоп-слов
+    using QueryPhrase = std::vector<std::pair<std::string_view, uint32_t>>;
+
+    // Узел булева выражения запроса. TERM есть в документе, если там есть любое из words:
+    // префикс и опечатки раскрываются в несколько слов. Фраза становится AND своих слов
+    struct QueryNode {
+        enum class Operation { TERM, AND, OR, NOT };
+
+        Operation operation = Operation::TERM;
+        std::vector<std::string_view> words;
+        std::vector<QueryNode> children;
     };
 
     struct Query {
+        Query() = default;
+        // Слова запроса могут указывать в folded_words, поэтому запрос можно только перемещать
+        Query(const Query&) = delete;
+        Query& operator=(const Query&) = delete;
+        Query(Query&&) = default;
+        Query& operator=(Query&&) = default;
+
+        // Слова запроса, приведённые токенизатором к нижнему регистру
+        WordStorage folded_words;
         std::vector<std::string_view> plus_words;
         std::vector<std::string_view> minus_words;
+        // Слова фраз попадают и в plus_words, фраза лишь отсеивает документы, где они стоят не подряд
+        std::vector<QueryPhrase> phrases;
+        // Множители вклада слов, добавленных поиском с опечатками; у остальных слов множитель 1
+        std::map<std::string_view, double> word_weights;
+
+        double GetWordWeight(std::string_view word) const {
+            const auto weight = word_weights.find(word);
+            return weight == word_weights.end() ? 1.0 : weight->second;
+        }
+
+        // Есть, если в запросе встречались +слово, AND, OR, NOT, скобки или фраза: в выдачу попадают только
+        // документы, удовлетворяющие выражению. Тогда plus_words — слова выражения не под отрицанием,
+        // а minus_words — слова под NOT или с минусом на верхнем уровне выражения: они исключают документ
+        // из всей выдачи
+        std::optional<QueryNode> constraint;
     };
 
-    std::set<int> count_documents_;
+    // Лексема запроса для разбора булева выражения. У TERM words пусто, если слово — стоп-слово
+    struct QueryToken {
+        enum class Type { TERM, OPEN, CLOSE, AND, OR, NOT };
+
+        Type type = Type::TERM;
+        std::vector<std::string_view> words;
+        bool is_phrase = false;
+        bool is_required = false;
+        bool is_excluded = false;
+    };
+
+    // План выполнения запроса. Списки документов слов найдены в индексе один раз
+    // и упорядочены от самого короткого
+    struct QueryPlan {
+        enum class Strategy {
+            // Запрос заведомо ничего не найдёт
+            EMPTY,
+            // Обход списков плюс-слов с накоплением релевантности по документам
+            TERM_AT_A_TIME,
+            // Проверка заранее отобранных document_ids по спискам плюс-слов
+            DOCUMENT_AT_A_TIME
+        };
+        using Postings = std::pair<std::string_view, const std::map<int, double>*>;
+
+        Strategy strategy = Strategy::TERM_AT_A_TIME;
+        std::vector<Postings> plus_postings;
+        std::vector<Postings> minus_postings;
+        size_t posting_count = 0;
+        // Отсортированные id кандидатов для DOCUMENT_AT_A_TIME, уже без документов с минус-словами
+        std::vector<int> document_ids;
+        // Документы, удовлетворяющие выражению запроса, если его проверяет TERM_AT_A_TIME
+        std::optional<DocumentSet> allowed_documents;
+    };
+
+    // Операнд списка OR: обязательный (+слово), необязательный или запрещённый (-слово, NOT)
+    struct QueryClause {
+        enum class Occurrence { SHOULD, MUST, MUST_NOT };
+
+        std::optional<QueryNode> node;
+        Occurrence occurrence = Occurrence::SHOULD;
+    };
+
+    // Бюджет без ограничений: с ним проверки в ядрах подсчёта исчезают при компиляции
+    struct UnlimitedBudget {
+        static constexpr bool Consume() noexcept {
+            return true;
+        }
+    };
+
+    // Сколько постингов ядро подсчёта может просмотреть до остановки и до какого момента.
+    // Часы опрашиваются раз в BUDGET_CLOCK_CHECK_INTERVAL постингов
+    class PostingBudget {
+    public:
+        explicit PostingBudget(size_t max_postings, QueryBudget::Clock::time_point deadline = QueryBudget::Clock::time_point::max()) noexcept
+            : max_postings_(max_postings)
+            , deadline_(deadline) {
+        }
+
+        // false, если бюджет исчерпан и постинг смотреть нельзя
+        bool Consume() noexcept {
+            if (scanned_postings_ == max_postings_
+                || (scanned_postings_ % BUDGET_CLOCK_CHECK_INTERVAL == 0 && deadline_ != QueryBudget::Clock::time_point::max()
+                    && QueryBudget::Clock::now() >= deadline_)) {
+                return false;
+            }
+            ++scanned_postings_;
+            return true;
+        }
+
+        void Extend(size_t postings) noexcept {
+            max_postings_ += postings;
+        }
+
+    private:
+        size_t max_postings_;
+        QueryBudget::Clock::time_point deadline_;
+        size_t scanned_postings_ = 0;
+    };
+
+    // Подсчёт релевантности по плану, прерванный по бюджету: с него подсчёт продолжается с того же постинга
+    struct ScoringState {
+        // Слово плана, которое обрабатывается сейчас
+        size_t term_index = 0;
+        // TERM_AT_A_TIME: первый непросмотренный постинг слова term_index, если слово уже начато
+        std::optional<std::map<int, double>::const_iterator> posting;
+        std::map<int, double> document_to_relevance;
+        // DOCUMENT_AT_A_TIME: следующий кандидат для слова term_index и накопленное по кандидатам plan.document_ids
+        size_t position = 0;
+        std::vector<const DocumentData*> document_data;
+        std::vector<double> relevance;
+        std::vector<char> is_matched;
+        uint64_t postings_probed = 0;
+    };
+
+    DocumentSet count_documents_;
+    // Словарь владеет текстом слов индекса и раздаёт им числовые id: ключи ниже не должны зависеть
+    // от времени жизни документа, который добавил слово первым. Слово, которого не осталось ни в одном
+    // документе, удаляется, поэтому автодополнение и раскрытие префиксов видят только слова документов
+    TermDictionary word_to_id_;
+    // Id удалённых слов не переиспользуются
+    int next_term_id_ = 0;
+    // Отсортированные id различных слов документа
+    std::map<int, std::vector<int>> document_to_term_ids_;
+    std::optional<NearDuplicateIndex> near_duplicates_;
+    std::optional<PositionalIndex> positional_index_;
+    std::optional<FuzzyMatchOptions> fuzzy_options_;
+    DuplicatePolicy duplicate_policy_ = DuplicatePolicy::ALLOW;
+    std::unordered_map<WordSetFingerprint, std::vector<int>, WordSetFingerprintHasher> fingerprint_to_documents_;
+    std::map<int, int> duplicate_of_;
     std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, std::map<std::string_view, double>> document_to_word_freqs_;
+    // Частоты слов документа одним отсортированным по слову массивом: его отдаёт GetWordFrequencies без копирования
+    std::map<int, std::vector<std::pair<std::string_view, double>>> document_to_word_freqs_;
+    // Объявлен до стоп-слов: они делятся им же при создании сервера
+    Tokenizer tokenizer_;
     StopWords stop_words_;
     std::map<int, DocumentData> documents_;
+    std::array<DocumentSet, DOCUMENT_STATUS_COUNT> status_to_documents_;
+    std::map<int, DocumentSet> rating_to_documents_;
+    uint64_t total_document_length_ = 0;
 
 
 
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
-    std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
+    std::optional<int> FindIndexedDuplicate(const std::vector<std::string_view>& words) const;
+
+    void UnregisterFingerprint(int document_id);
+
+    // Слова, приведённые к нижнему регистру, складываются в storage
+    std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text, WordStorage& storage) const;
 
     QueryWord  ParseQueryWord(std::string_view text) const;
 
     Query ParseQuery(std::string_view text, const bool& is_match_par = false) const;
 
+    // Слова с * на конце раскрываются по dictionary в первые MAX_PREFIX_EXPANSIONS слов с этим префиксом.
+    // Шардированный сервер передаёт сюда общий словарь шардов
+    Query ParseQuery(std::string_view text, const TermDictionary& dictionary, bool is_match_par = false) const;
+
+    // Рекурсивный спуск по лексемам: any_of := all_of { [OR] all_of }, all_of := operand { AND operand },
+    // operand := NOT operand | ( any_of ) | слово. Соседние операнды без оператора соединяются через OR.
+    // Если среди операндов OR есть обязательные, документ должен содержать их все, а необязательные
+    // только добавляют релевантность. Запрещённые операнды вычитаются из результата списка.
+    // scored_words получает слова не под отрицанием
+    static std::optional<QueryNode> ParseAnyOf(const std::vector<QueryToken>& tokens, size_t& position, bool is_negated,
+        std::vector<std::string_view>& scored_words);
+    static QueryClause ParseAllOf(const std::vector<QueryToken>& tokens, size_t& position, bool is_negated,
+        std::vector<std::string_view>& scored_words);
+    static QueryClause ParseOperand(const std::vector<QueryToken>& tokens, size_t& position, bool is_negated,
+        std::vector<std::string_view>& scored_words);
+    // AND и OR из одного операнда заменяются самим операндом
+    static QueryNode CombineQueryNodes(QueryNode::Operation operation, std::vector<QueryNode> children);
+    // Слова TERM под NOT на верхнем уровне выражения: документ с любым из них не удовлетворяет выражению
+    static void CollectExcludedWords(const QueryNode& node, std::vector<std::string_view>& words);
+    // Добавляет alternative ко всем TERM выражения, где есть word
+    static void AddTermAlternative(QueryNode& node, std::string_view word, std::string_view alternative);
+
+    // Дополняет редкие плюс-слова близкими словами dictionary; document_freq(word) — в скольких документах слово
+    template <typename DocumentFreq>
+    static void ExpandFuzzyWords(Query& query, const TermDictionary& dictionary, const FuzzyMatchOptions& options,
+        DocumentFreq document_freq, bool is_match_par = false);
+
     double ComputeWordInverseDocumentFreq(const std::string_view& word) const;
 
+    TermStatistics GetTermStatistics(std::string_view word) const;
+
+    void IndexPositions(int document_id, std::string_view text);
+
+    void UnregisterFilterIndexes(int document_id);
+
+    // Удаляет из словаря слово, у которого не осталось документов
+    void EraseWordIfUnused(std::string_view word);
+
+    // Фильтр, который пропускает все документы индекса
+    bool IsTrivialFilter(const DocumentFilter& filter) const;
+
+    // Отсортированные id документов, проходящих filter, если проверить их по спискам слов запроса
+    // дешевле, чем просмотреть сами списки; иначе пусто
+    std::optional<std::vector<int>> SelectFilteredDocuments(const DocumentFilter& filter, size_t max_selected) const;
+
+    ScoringState StartScoring(const QueryPlan& plan) const;
+
+    // Продолжает подсчёт с места state, пока budget не исчерпан; true, если план посчитан целиком.
+    // FindTopDocuments считает с UnlimitedBudget, запрос с QueryBudget — до его исчерпания, асинхронный
+    // запрос — блоками постингов. Слова плана идут от редких к частым
+    template <typename Key_mapper, typename TermStats, typename Ranker, typename Budget>
+    bool ScorePlan(const QueryPlan& plan, const Query& query, const Key_mapper& status,
+        const TermStats& term_statistics, const Ranker& ranker, Budget& budget, ScoringState& state) const;
+
+    // Обход списков плюс-слов с накоплением релевантности по документам
+    template <typename Key_mapper, typename TermStats, typename Ranker, typename Budget>
+    bool ScoreTerms(const QueryPlan& plan, const Query& query, const Key_mapper& status,
+        const TermStats& term_statistics, const Ranker& ranker, Budget& budget, ScoringState& state) const;
+
+    // Релевантность plan.document_ids по спискам плюс-слов
+    template <typename TermStats, typename Ranker, typename Budget>
+    bool ScoreCandidates(const QueryPlan& plan, const Query& query,
+        const TermStats& term_statistics, const Ranker& ranker, Budget& budget, ScoringState& state) const;
+
+    // Документы, набравшие релевантность в state, без минус-слов, фраз и вне выражения запроса
+    std::vector<Document> CollectScoredDocuments(const QueryPlan& plan, const Query& query, const ScoringState& state) const;
+
+    // Верхняя оценка числа документов, удовлетворяющих узлу
+    size_t EstimateDocumentCount(const QueryNode& node) const;
+
+    // Документы, удовлетворяющие узлу. Операнды AND вычисляются от самого редкого, пересечение
+    // прекращается, как только стало пустым, а слово проверяется по его списку документов,
+    // если кандидатов меньше, чем документов в списке
+    DocumentSet EvaluateQueryNode(const QueryNode& node) const;
+
+    bool MatchesQueryNode(const QueryNode& node, int document_id) const;
+
+    bool SatisfiesConstraint(const Query& query, int document_id) const;
+
+    // Отсортированные id документов из documents, проходящих status
+    template <typename Key_mapper>
+    std::vector<int> SelectConstrainedDocuments(DocumentSet documents, const Key_mapper& status) const;
+
+    // Фразы запроса в id слов этого сервера. Слово, которого нет в словаре, получает id -1 и фразу не находит
+    std::vector<PositionalIndex::Phrase> ResolvePhrases(const Query& query) const;
+
+    bool ContainsPhrases(const std::vector<PositionalIndex::Phrase>& phrases, int document_id) const;
+
+    // Короткий документ дешевле проверить слиянием id слов запроса с его отсортированными id слов,
+    // чем искать документ в списке каждого слова запроса
+    bool PrefersForwardMatch(const Query& query, int document_id) const;
+
+    match_tuple MatchDocumentByTermIds(const Query& query, int document_id) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<match_tuple> MatchDocumentBatch(ExecutionPolicy&& policy, std::string_view raw_query,
+        std::span<const int> document_ids) const;
+
+    // Отмечает позиции отсортированной пачки id, которые есть в списке документов слова
+    static void MarkPostingHits(const std::map<int, double>& word_freqs, const std::vector<int>& sorted_ids, std::vector<char>& hits);
+
     template<typename Key_mapper>
     std::vector<Document> FindAllDocuments(const Query& query, const Key_mapper& status) const;
 
@@ -134,19 +582,114 @@ private:
     std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy&, const Query& query, const Key_mapper& status) const;
 
     template<typename Key_mapper>
-    std::vector<Document> FindAllDocuments(const std::execution::parallel_policy&, const Query& query, Key_mapper status) const;
+    std::vector<Document> FindAllDocuments(const std::execution::parallel_policy&, const Query& query, const Key_mapper& status) const;
+
+    // term_statistics отдаёт статистику слова: шардированный сервер подставляет сюда общую по всем шардам.
+    // Стратегию выбирает PlanQuery. Ядро подсчёта выбирается по типу предиката: NoDocumentFilter не читает
+    // данные документа вовсе (если они не нужны ранжировщику), DocumentFilter без ограничений сводится к нему
+    // во время выполнения
+    template<typename Key_mapper, typename TermStats, typename Ranker>
+    std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy&, const Query& query, const Key_mapper& status,
+        const TermStats& term_statistics, const Ranker& ranker) const;
+
+    template<typename Key_mapper, typename TermStats, typename Ranker>
+    std::vector<Document> FindAllDocuments(const std::execution::parallel_policy&, const Query& query, const Key_mapper& status,
+        const TermStats& term_statistics, const Ranker& ranker) const;
+
+    template<typename ExecutionPolicy, typename Key_mapper, typename TermStats, typename Ranker>
+    std::vector<Document> FindPlannedDocuments(const ExecutionPolicy& policy, const Query& query, const Key_mapper& status,
+        const TermStats& term_statistics, const Ranker& ranker) const;
+
+    // Списки плюс-слов параллельно, без бюджета
+    template<typename Key_mapper, typename TermStats, typename Ranker>
+    std::vector<Document> ScoreTermAtATime(const std::execution::parallel_policy&, const QueryPlan& plan, const Query& query,
+        const Key_mapper& status, const TermStats& term_statistics, const Ranker& ranker) const;
+
+    // Документ-за-документом выгоднее, когда проверить каждого кандидата по спискам всех плюс-слов дешевле,
+    // чем просмотреть эти списки: кандидатов даёт выражение запроса или фильтр по статусу и рейтингу
+    template <typename Key_mapper>
+    QueryPlan PlanQuery(const Query& query, const Key_mapper& status) const;
+
+    // Часть плана, не зависящая от предиката: поиск и упорядочивание списков, выражение запроса
+    // и признаки пустого результата — нет ни одного известного плюс-слова, минус-слово есть во всех
+    // документах или выражению не удовлетворяет ни один документ
+    QueryPlan PlanTerms(const Query& query) const;
+
+    // Убирает из отсортированных document_ids документы со словами minus_postings. Списки идут от коротких,
+    // каждый проверяется поиском кандидатов в нём или слиянием, смотря что дешевле, и обход
+    // прекращается, когда кандидатов не осталось
+    void ExcludeDocuments(const std::vector<QueryPlan::Postings>& minus_postings, std::vector<int>& document_ids) const;
+
+    // Передаёт accumulate(id, вклад) для постингов слова от first до last, прошедших status, пока budget
+    // не исчерпан; возвращает первый непросмотренный постинг
+    template <typename Key_mapper, typename Ranker, typename Budget, typename Accumulate>
+    std::map<int, double>::const_iterator ScorePostings(std::map<int, double>::const_iterator first,
+        std::map<int, double>::const_iterator last, const Key_mapper& status, const Ranker& ranker,
+        const typename Ranker::TermWeight& term_weight, double word_weight, Budget& budget, Accumulate accumulate) const;
+
+    // Документы, в которых есть хотя бы одно из слов
+    DocumentSet CollectDocuments(const std::vector<std::string_view>& words) const;
+
+    // Убирает документы с минус-словами, без фраз и вне выражения запроса и добавляет рейтинги
+    std::vector<Document> CollectMatchedDocuments(const QueryPlan& plan, const Query& query,
+        const std::map<int, double>& document_to_relevance) const;
 };
 
 template <typename Container>
-StopWords::StopWords(const Container& container) {
-    for (auto element : container) {
+StopWords::StopWords(const Container& container, const Tokenizer& tokenizer) {
+    for (const auto& element : container) {
         if (!element.empty()) {
             if (!IsValidWord(element)) {
                 throw std::invalid_argument("Стоп-слово содержит спецсимволы"s);
             }
-            stop_words.emplace(element);
+            WordStorage folded_words;
+            for (const std::string_view word : tokenizer.Tokenize(element, folded_words)) {
+                stop_words.emplace(word);
+            }
+        }
+    }
+}
+
+template <typename DocumentFreq>
+void SearchServer::ExpandFuzzyWords(Query& query, const TermDictionary& dictionary, const FuzzyMatchOptions& options,
+    DocumentFreq document_freq, bool is_match_par) {
+    const size_t exact_word_count = query.plus_words.size();
+    for (size_t i = 0; i < exact_word_count; ++i) {
+        const std::string_view plus = query.plus_words[i];
+        if (document_freq(plus) > options.max_document_freq) {
+            continue;
+        }
+        auto matches = FindTermsWithinDistance(dictionary, plus, options.max_edits);
+        std::stable_sort(matches.begin(), matches.end(), [](const TermMatch& lhs, const TermMatch& rhs) {
+            return lhs.distance < rhs.distance;
+            });
+        size_t expansion_count = 0;
+        for (const auto& [term, distance] : matches) {
+            if (expansion_count == options.max_expansions) {
+                break;
+            }
+            const bool is_exact = std::find(query.plus_words.begin(), query.plus_words.begin() + exact_word_count, term)
+                != query.plus_words.begin() + exact_word_count;
+            if (distance == 0 || is_exact) {
+                continue;
+            }
+            ++expansion_count;
+            const double weight = std::pow(options.edit_penalty, distance);
+            const auto [stored_weight, is_new] = query.word_weights.emplace(term, weight);
+            if (query.constraint) {
+                AddTermAlternative(*query.constraint, plus, term);
+            }
+            if (is_new) {
+                query.plus_words.push_back(term);
+            }
+            else {
+                stored_weight->second = std::max(stored_weight->second, weight);
+            }
         }
     }
+    if (!is_match_par) {
+        std::sort(query.plus_words.begin(), query.plus_words.end());
+    }
 }
 
 template <typename DocumentPredicate>
@@ -155,31 +698,102 @@ std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query,
     return SearchServer::FindTopDocuments(std::execution::seq, raw_query, document_predicate);
 }
 
+template <typename DocumentPredicate>
+SearchResult SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, const QueryBudget& budget) const {
+    return FindTopDocuments(raw_query, document_predicate, budget, TfIdfRanker{});
+}
+
+template <typename DocumentPredicate, typename Ranker>
+SearchResult SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, const QueryBudget& budget,
+    const Ranker& ranker) const {
+    const Query query = ParseQuery(raw_query);
+    const QueryPlan plan = PlanQuery(query, document_predicate);
+    ScoringState state = StartScoring(plan);
+    PostingBudget posting_budget(budget.max_postings, budget.deadline);
+    SearchResult result;
+    result.is_partial = !ScorePlan(plan, query, document_predicate,
+        [this](std::string_view word) { return GetTermStatistics(word); }, ranker, posting_budget, state);
+    result.documents = CollectScoredDocuments(plan, query, state);
+
+    const size_t top_count = std::min(result.documents.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    std::partial_sort(result.documents.begin(), result.documents.begin() + top_count, result.documents.end(), IsMoreRelevant);
+    result.documents.resize(top_count);
+    return result;
+}
+
 template <typename DocumentPredicate, typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query,
     DocumentPredicate document_predicate) const {
+    return FindTopDocuments(policy, raw_query, document_predicate, TfIdfRanker{});
+}
+
+template <typename DocumentPredicate, typename ExecutionPolicy, typename Ranker>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query,
+    DocumentPredicate document_predicate, const Ranker& ranker) const {
+    SCOPED_TIMER("SearchServer::FindTopDocuments");
+    QueryStatsScope stats_scope;
     const Query query = ParseQuery(raw_query);
-    auto matched_documents = FindAllDocuments(policy, query, document_predicate);
-    std::sort(policy, matched_documents.begin(), matched_documents.end(),
-        [](const Document& lhs, const Document& rhs) {
-            if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-                return lhs.rating > rhs.rating;
-            }
-            else {
-                return lhs.relevance > rhs.relevance;
-            }
-        });
+    stats_scope.FinishPhase(&QueryStats::parse_nanoseconds);
+    auto matched_documents = FindAllDocuments(policy, query, document_predicate,
+        [this](std::string_view word) { return GetTermStatistics(word); }, ranker);
+    stats_scope.FinishPhase(&QueryStats::score_nanoseconds);
+    std::sort(policy, matched_documents.begin(), matched_documents.end(), IsMoreRelevant);
     if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
         matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
     }
+    stats_scope.FinishPhase(&QueryStats::select_nanoseconds);
     return matched_documents;
 }
 
+template <typename DocumentPredicate, typename ExecutionPolicy, typename Ranker>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query,
+    DocumentPredicate document_predicate, const Ranker& ranker, QueryStats& stats) const {
+    stats = {};
+    QueryStatsScope stats_scope(&stats);
+    return FindTopDocuments(policy, raw_query, document_predicate, ranker);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+SearchPage SearchServer::FindTopDocumentsPage(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate,
+    size_t page_size, const std::optional<SearchCursor>& after) const {
+    const Query query = ParseQuery(raw_query);
+    auto matched_documents = FindAllDocuments(policy, query, document_predicate);
+    if (after) {
+        const Document last{ after->document_id, after->relevance, after->rating };
+        matched_documents.erase(std::remove_if(matched_documents.begin(), matched_documents.end(),
+            [&last](const Document& document) { return !IsRankedBefore(last, document); }), matched_documents.end());
+    }
+
+    SearchPage page;
+    const size_t page_end = std::min(page_size, matched_documents.size());
+    std::partial_sort(policy, matched_documents.begin(), matched_documents.begin() + page_end, matched_documents.end(), IsRankedBefore);
+    if (matched_documents.size() > page_size && page_size > 0) {
+        const Document& last = matched_documents[page_size - 1];
+        page.next_cursor = SearchCursor{ last.relevance, last.rating, last.id };
+    }
+    matched_documents.resize(page_end);
+    page.documents = std::move(matched_documents);
+    return page;
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsPageByIndex(ExecutionPolicy&& policy, std::string_view raw_query,
+    DocumentPredicate document_predicate, size_t page_index, size_t page_size) const {
+    auto matched_documents = FindAllDocuments(policy, ParseQuery(raw_query), document_predicate);
+    const size_t page_begin = std::min(page_index * page_size, matched_documents.size());
+    const size_t page_end = std::min(page_begin + page_size, matched_documents.size());
+    // nth_element отделяет документы предыдущих страниц, сортируется только сама страница
+    if (page_begin > 0 && page_begin < matched_documents.size()) {
+        std::nth_element(policy, matched_documents.begin(), matched_documents.begin() + page_begin, matched_documents.end(), IsRankedBefore);
+    }
+    std::partial_sort(policy, matched_documents.begin() + page_begin, matched_documents.begin() + page_end, matched_documents.end(),
+        IsRankedBefore);
+    return { matched_documents.begin() + page_begin, matched_documents.begin() + page_end };
+}
+
 template <typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(policy, raw_query,
-        [status](int document_id, DocumentStatus document_status, int rating)
-        { return document_status == status; });
+    return FindTopDocuments(policy, raw_query, DocumentFilter{ status });
 }
 
 template <typename ExecutionPolicy>
@@ -187,6 +801,91 @@ std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, s
     return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
 }
 
+template <typename DocumentPredicate>
+SearchTask<std::vector<Document>> SearchServer::FindTopDocumentsAsync(QueryExecutor& executor, std::string raw_query,
+    DocumentPredicate document_predicate, AsyncQueryOptions options) const {
+    co_await executor.Schedule();
+    options.ThrowIfCancelled();
+    const Query query = ParseQuery(raw_query);
+    const QueryPlan plan = PlanQuery(query, document_predicate);
+    const auto term_statistics = [this](std::string_view word) { return GetTermStatistics(word); };
+    const TfIdfRanker ranker;
+
+    // План и ядра те же, что у FindTopDocuments, но между блоками постингов поток достаётся другим запросам
+    ScoringState state = StartScoring(plan);
+    PostingBudget budget(ASYNC_POSTING_BLOCK);
+    while (!ScorePlan(plan, query, document_predicate, term_statistics, ranker, budget, state)) {
+        co_await executor.Schedule();
+        options.ThrowIfCancelled();
+        budget.Extend(ASYNC_POSTING_BLOCK);
+    }
+
+    std::vector<Document> matched_documents = CollectScoredDocuments(plan, query, state);
+    std::sort(matched_documents.begin(), matched_documents.end(), IsMoreRelevant);
+    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
+        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    }
+    co_return matched_documents;
+}
+
+template <typename ExecutionPolicy>
+std::vector<SearchServer::match_tuple> SearchServer::MatchDocumentBatch(ExecutionPolicy&& policy, std::string_view raw_query,
+    std::span<const int> document_ids) const {
+    const Query query = ParseQuery(raw_query);
+    const auto phrases = ResolvePhrases(query);
+
+    std::vector<int> sorted_ids(document_ids.begin(), document_ids.end());
+    std::sort(sorted_ids.begin(), sorted_ids.end());
+    sorted_ids.erase(std::unique(sorted_ids.begin(), sorted_ids.end()), sorted_ids.end());
+
+    std::vector<const std::pair<const std::string_view, std::map<int, double>>*> plus_postings;
+    for (const auto plus : query.plus_words) {
+        const auto word_freqs = word_to_document_freqs_.find(plus);
+        if (word_freqs != word_to_document_freqs_.end()) {
+            plus_postings.push_back(&*word_freqs);
+        }
+    }
+    std::vector<const std::map<int, double>*> minus_postings;
+    for (const auto minus : query.minus_words) {
+        const auto word_freqs = word_to_document_freqs_.find(minus);
+        if (word_freqs != word_to_document_freqs_.end()) {
+            minus_postings.push_back(&word_freqs->second);
+        }
+    }
+
+    std::vector<std::vector<char>> plus_hits(plus_postings.size(), std::vector<char>(sorted_ids.size()));
+    std::vector<std::vector<char>> minus_hits(minus_postings.size(), std::vector<char>(sorted_ids.size()));
+    std::vector<size_t> plus_indexes(plus_postings.size());
+    std::iota(plus_indexes.begin(), plus_indexes.end(), 0);
+    std::vector<size_t> minus_indexes(minus_postings.size());
+    std::iota(minus_indexes.begin(), minus_indexes.end(), 0);
+    std::for_each(policy, minus_indexes.begin(), minus_indexes.end(), [&](size_t index) {
+        MarkPostingHits(*minus_postings[index], sorted_ids, minus_hits[index]);
+        });
+    std::for_each(policy, plus_indexes.begin(), plus_indexes.end(), [&](size_t index) {
+        MarkPostingHits(plus_postings[index]->second, sorted_ids, plus_hits[index]);
+        });
+
+    std::vector<match_tuple> result;
+    result.reserve(document_ids.size());
+    for (const int document_id : document_ids) {
+        const DocumentStatus status = documents_.at(document_id).status;
+        const size_t position = std::lower_bound(sorted_ids.begin(), sorted_ids.end(), document_id) - sorted_ids.begin();
+        std::vector<std::string_view> match_words;
+        const bool is_excluded = std::any_of(minus_hits.begin(), minus_hits.end(), [position](const auto& hits) { return hits[position]; })
+            || !ContainsPhrases(phrases, document_id) || !SatisfiesConstraint(query, document_id);
+        if (!is_excluded) {
+            for (size_t index = 0; index < plus_postings.size(); ++index) {
+                if (plus_hits[index][position]) {
+                    match_words.push_back(plus_postings[index]->first);
+                }
+            }
+        }
+        result.emplace_back(std::move(match_words), status);
+    }
+    return result;
+}
+
 template<typename Key_mapper>
 std::vector<Document> SearchServer::FindAllDocuments(const Query& query, const Key_mapper& status) const {
     return FindAllDocuments(std::execution::seq, query, status);
@@ -194,66 +893,191 @@ std::vector<Document> SearchServer::FindAllDocuments(const Query& query, const K
 
 template<typename Key_mapper>
 std::vector<Document> SearchServer::FindAllDocuments(const std::execution::sequenced_policy& policy, const Query& query, const Key_mapper& status) const {
-    std::vector<Document> matched_documents;
-    std::map <int, double> document_to_relevance;
-    for (auto plus : query.plus_words) {
-        if (word_to_document_freqs_.count(plus) == 0) {
-            continue;
+    return FindAllDocuments(policy, query, status,
+        [this](std::string_view word) { return GetTermStatistics(word); }, TfIdfRanker{});
+}
+
+template <typename Key_mapper, typename Ranker, typename Budget, typename Accumulate>
+std::map<int, double>::const_iterator SearchServer::ScorePostings(std::map<int, double>::const_iterator first,
+    std::map<int, double>::const_iterator last, const Key_mapper& status, const Ranker& ranker,
+    const typename Ranker::TermWeight& term_weight, double word_weight, Budget& budget, Accumulate accumulate) const {
+    if constexpr (std::is_same_v<Key_mapper, NoDocumentFilter> && !UsesDocumentLength<Ranker>()) {
+        for (; first != last && budget.Consume(); ++first) {
+            accumulate(first->first, ranker.Score(term_weight, first->second, 0) * word_weight);
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(plus);
-        for (auto [document_id, term_freq] : word_to_document_freqs_.at(plus)) {
-            const auto document_data = documents_.at(document_id);
-            if (status(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+    }
+    else {
+        for (; first != last && budget.Consume(); ++first) {
+            const auto& [document_id, term_freq] = *first;
+            const DocumentData& document_data = documents_.at(document_id);
+            if constexpr (!std::is_same_v<Key_mapper, NoDocumentFilter>) {
+                if (!status(document_id, document_data.status, document_data.rating)) {
+                    continue;
+                }
             }
+            accumulate(document_id, ranker.Score(term_weight, term_freq, document_data.length) * word_weight);
         }
     }
-    for (const auto minus : query.minus_words) {
-        if (word_to_document_freqs_.count(minus) == 0) {
-            continue;
+    return first;
+}
+
+template<typename Key_mapper, typename TermStats, typename Ranker>
+std::vector<Document> SearchServer::FindAllDocuments(const std::execution::sequenced_policy& policy, const Query& query, const Key_mapper& status,
+    const TermStats& term_statistics, const Ranker& ranker) const {
+    return FindPlannedDocuments(policy, query, status, term_statistics, ranker);
+}
+
+template<typename Key_mapper>
+std::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy& policy, const Query& query, const Key_mapper& status) const {
+    return FindAllDocuments(policy, query, status,
+        [this](std::string_view word) { return GetTermStatistics(word); }, TfIdfRanker{});
+}
+
+template<typename Key_mapper, typename TermStats, typename Ranker>
+std::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy& policy, const Query& query, const Key_mapper& status,
+    const TermStats& term_statistics, const Ranker& ranker) const {
+    return FindPlannedDocuments(policy, query, status, term_statistics, ranker);
+}
+
+template<typename ExecutionPolicy, typename Key_mapper, typename TermStats, typename Ranker>
+std::vector<Document> SearchServer::FindPlannedDocuments(const ExecutionPolicy& policy, const Query& query, const Key_mapper& status,
+    const TermStats& term_statistics, const Ranker& ranker) const {
+    const QueryPlan plan = PlanQuery(query, status);
+    if constexpr (std::is_same_v<ExecutionPolicy, std::execution::parallel_policy>) {
+        if (plan.strategy == QueryPlan::Strategy::TERM_AT_A_TIME) {
+            if constexpr (std::is_same_v<Key_mapper, DocumentFilter>) {
+                if (IsTrivialFilter(status)) {
+                    return ScoreTermAtATime(policy, plan, query, NoDocumentFilter{}, term_statistics, ranker);
+                }
+            }
+            return ScoreTermAtATime(policy, plan, query, status, term_statistics, ranker);
         }
-        for (const auto& [document_id, _] : word_to_document_freqs_.at(minus)) {
-            document_to_relevance.erase(document_id);
+    }
+    ScoringState state = StartScoring(plan);
+    UnlimitedBudget budget;
+    ScorePlan(plan, query, status, term_statistics, ranker, budget, state);
+    return CollectScoredDocuments(plan, query, state);
+}
+
+template <typename Key_mapper, typename TermStats, typename Ranker, typename Budget>
+bool SearchServer::ScorePlan(const QueryPlan& plan, const Query& query, const Key_mapper& status,
+    const TermStats& term_statistics, const Ranker& ranker, Budget& budget, ScoringState& state) const {
+    switch (plan.strategy) {
+    case QueryPlan::Strategy::EMPTY:
+        return true;
+    case QueryPlan::Strategy::DOCUMENT_AT_A_TIME:
+        return ScoreCandidates(plan, query, term_statistics, ranker, budget, state);
+    case QueryPlan::Strategy::TERM_AT_A_TIME:
+        break;
+    }
+    if constexpr (std::is_same_v<Key_mapper, DocumentFilter>) {
+        if (IsTrivialFilter(status)) {
+            return ScoreTerms(plan, query, NoDocumentFilter{}, term_statistics, ranker, budget, state);
         }
     }
-    for (auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back({ document_id,
-                                      relevance,
-                                      documents_.at(document_id).rating });
+    return ScoreTerms(plan, query, status, term_statistics, ranker, budget, state);
+}
+
+template <typename Key_mapper, typename TermStats, typename Ranker, typename Budget>
+bool SearchServer::ScoreTerms(const QueryPlan& plan, const Query& query, const Key_mapper& status,
+    const TermStats& term_statistics, const Ranker& ranker, Budget& budget, ScoringState& state) const {
+    for (; state.term_index < plan.plus_postings.size(); ++state.term_index, state.posting.reset()) {
+        const auto& [plus, word_freqs] = plan.plus_postings[state.term_index];
+        const auto stop = ScorePostings(state.posting.value_or(word_freqs->begin()), word_freqs->end(), status, ranker,
+            ranker.PrepareTerm(term_statistics(plus)), query.GetWordWeight(plus), budget,
+            [&state](int document_id, double score) { state.document_to_relevance[document_id] += score; });
+        if (stop != word_freqs->end()) {
+            state.posting = stop;
+            return false;
+        }
     }
-    return matched_documents;
+    return true;
 }
 
-template<typename Key_mapper>
-std::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy&, const Query& query, Key_mapper status) const {
+template<typename Key_mapper, typename TermStats, typename Ranker>
+std::vector<Document> SearchServer::ScoreTermAtATime(const std::execution::parallel_policy&, const QueryPlan& plan, const Query& query,
+    const Key_mapper& status, const TermStats& term_statistics, const Ranker& ranker) const {
     ConcurrentMap<int, double> document_to_relevance(BUCKETS);
-    std::for_each(std::execution::par, query.minus_words.begin(), query.minus_words.end(), [this, &document_to_relevance](std::string_view minus) {
-        if (word_to_document_freqs_.count(minus)) {
-            for (const auto [document_id, _] : word_to_document_freqs_.at(minus)) {
-                document_to_relevance.Erase(document_id);
-            }
-        }
-        });
-    std::for_each(std::execution::par, query.plus_words.begin(), query.plus_words.end(), [this, &status, &document_to_relevance](std::string_view plus) {
-        if (word_to_document_freqs_.count(plus)) {
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(plus);
-            for (auto [document_id, term_freq] : word_to_document_freqs_.at(plus)) {
-                const auto document_data = documents_.at(document_id);
-                if (status(document_id, document_data.status, document_data.rating)) {
-                    document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
-                }
-            }
-        };
+    std::for_each(std::execution::par, plan.plus_postings.begin(), plan.plus_postings.end(), [&](const QueryPlan::Postings& postings) {
+        UnlimitedBudget budget;
+        ScorePostings(postings.second->begin(), postings.second->end(), status, ranker, ranker.PrepareTerm(term_statistics(postings.first)),
+            query.GetWordWeight(postings.first), budget,
+            [&document_to_relevance](int document_id, double score) { document_to_relevance[document_id].ref_to_value += score; });
         });
+    return CollectMatchedDocuments(plan, query, document_to_relevance.BuildOrdinaryMap());
+}
 
-    std::map<int, double> document_to_relevance_reduced = document_to_relevance.BuildOrdinaryMap();
-    std::vector<Document> matched_documents;
-    matched_documents.reserve(document_to_relevance_reduced.size());
-    for (auto [document_id, relevance] : document_to_relevance_reduced) {
-        matched_documents.push_back({ document_id,
-                                      relevance,
-                                      documents_.at(document_id).rating });
+template <typename Key_mapper>
+SearchServer::QueryPlan SearchServer::PlanQuery(const Query& query, const Key_mapper& status) const {
+    QueryPlan plan = PlanTerms(query);
+    if (plan.strategy == QueryPlan::Strategy::EMPTY) {
+        return plan;
     }
-    return matched_documents;
+    // Проверка одного кандидата стоит по поиску в списке каждого плюс-слова
+    const size_t max_candidates = plan.posting_count / plan.plus_postings.size();
+    if (plan.allowed_documents) {
+        if (plan.allowed_documents->size() < max_candidates) {
+            plan.document_ids = SelectConstrainedDocuments(std::move(*plan.allowed_documents), status);
+            plan.allowed_documents.reset();
+            plan.strategy = QueryPlan::Strategy::DOCUMENT_AT_A_TIME;
+        }
+    }
+    else if constexpr (std::is_same_v<Key_mapper, DocumentFilter>) {
+        if (auto document_ids = SelectFilteredDocuments(status, max_candidates)) {
+            plan.document_ids = std::move(*document_ids);
+            plan.strategy = QueryPlan::Strategy::DOCUMENT_AT_A_TIME;
+        }
+    }
+    if (plan.strategy == QueryPlan::Strategy::DOCUMENT_AT_A_TIME) {
+        ExcludeDocuments(plan.minus_postings, plan.document_ids);
+        if (plan.document_ids.empty()) {
+            plan.strategy = QueryPlan::Strategy::EMPTY;
+        }
+    }
+    return plan;
 }
 
+template <typename Key_mapper>
+std::vector<int> SearchServer::SelectConstrainedDocuments(DocumentSet documents, const Key_mapper& status) const {
+    if constexpr (std::is_same_v<Key_mapper, DocumentFilter>) {
+        if (status.status) {
+            documents &= status_to_documents_[static_cast<size_t>(*status.status)];
+        }
+    }
+    std::vector<int> document_ids;
+    document_ids.reserve(documents.size());
+    for (const int document_id : documents) {
+        if constexpr (!std::is_same_v<Key_mapper, NoDocumentFilter>) {
+            const DocumentData& document_data = documents_.at(document_id);
+            if (!status(document_id, document_data.status, document_data.rating)) {
+                continue;
+            }
+        }
+        document_ids.push_back(document_id);
+    }
+    return document_ids;
+}
+
+template <typename TermStats, typename Ranker, typename Budget>
+bool SearchServer::ScoreCandidates(const QueryPlan& plan, const Query& query,
+    const TermStats& term_statistics, const Ranker& ranker, Budget& budget, ScoringState& state) const {
+    const std::vector<int>& document_ids = plan.document_ids;
+    for (; state.term_index < plan.plus_postings.size(); ++state.term_index, state.position = 0) {
+        const auto& [plus, word_freqs] = plan.plus_postings[state.term_index];
+        const auto term_weight = ranker.PrepareTerm(term_statistics(plus));
+        const double word_weight = query.GetWordWeight(plus);
+        for (; state.position < document_ids.size(); ++state.position) {
+            if (!budget.Consume()) {
+                return false;
+            }
+            ++state.postings_probed;
+            const size_t i = state.position;
+            const auto posting = word_freqs->find(document_ids[i]);
+            if (posting != word_freqs->end()) {
+                state.relevance[i] += ranker.Score(term_weight, posting->second, state.document_data[i]->length) * word_weight;
+                state.is_matched[i] = true;
+            }
+        }
+    }
+    return true;
+}
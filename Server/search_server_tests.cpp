@@ -0,0 +1,614 @@
+#include "search_server_tests.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <execution>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <numeric>
+#include <set>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "async_search.h"
+#include "benchmark.h"
+#include "document_set.h"
+#include "near_duplicates.h"
+#include "request_statistics.h"
+#include "search_server.h"
+#include "sharded_search_server.h"
+#include "string_processing.h"
+#include "term_dictionary.h"
+#include "tokenizer.h"
+#include "test_framework.h"
+
+namespace {
+
+std::set<int> FindDocumentIds(const SearchServer& search_server, std::string_view raw_query) {
+    std::set<int> document_ids;
+    for (const Document& document : search_server.FindTopDocuments(raw_query)) {
+        document_ids.insert(document.id);
+    }
+    return document_ids;
+}
+
+// Небольшой корпус для сравнения реализаций: ничего не проверяет сам, только даёт разнообразные запросы
+Corpus MakeTestCorpus() {
+    CorpusOptions options;
+    options.dictionary_size = 300;
+    options.document_count = 500;
+    options.min_document_length = 5;
+    options.max_document_length = 30;
+    options.query_count = 100;
+    return GenerateCorpus(options);
+}
+
+void AssertSameDocuments(const std::vector<Document>& actual, const std::vector<Document>& expected, std::string_view raw_query) {
+    const std::string hint = "query: "s + std::string(raw_query);
+    AssertEqual(actual.size(), expected.size(), hint);
+    for (size_t i = 0; i < actual.size(); ++i) {
+        AssertEqual(actual[i].id, expected[i].id, hint);
+        AssertEqual(actual[i].rating, expected[i].rating, hint);
+        Assert(std::abs(actual[i].relevance - expected[i].relevance) < EPSILON, hint);
+    }
+}
+
+// Занимает место в очереди пула и выполняет action на его потоке
+SearchTask<bool> RunOnExecutor(QueryExecutor& executor, std::function<void()> action) {
+    co_await executor.Schedule();
+    action();
+    co_return true;
+}
+
+template <typename T>
+std::future<T> StartTask(SearchTask<T>& task) {
+    std::promise<T> result;
+    auto future = result.get_future();
+    AsyncSearchPrivate::Complete(task, std::move(result));
+    return future;
+}
+
+// Задача пула из одного потока начинается, пока поток занят, поэтому interrupt выполняется ровно тогда,
+// когда задача впервые уступит поток, — посреди запроса
+template <typename T>
+std::future<T> RunInterrupted(QueryExecutor& executor, SearchTask<T> task, std::function<void()> interrupt) {
+    std::promise<void> gate;
+    const std::shared_future<void> gate_opened = gate.get_future().share();
+    auto blocker = RunOnExecutor(executor, [gate_opened] { gate_opened.wait(); });
+    auto interrupter = RunOnExecutor(executor, std::move(interrupt));
+    auto blocked = StartTask(blocker);
+    auto result = StartTask(task);
+    auto interrupted = StartTask(interrupter);
+    gate.set_value();
+    blocked.wait();
+    interrupted.wait();
+    result.wait();
+    return result;
+}
+
+std::vector<int> MakeTermIdRange(int first, int last) {
+    std::vector<int> term_ids(last - first);
+    std::iota(term_ids.begin(), term_ids.end(), first);
+    return term_ids;
+}
+
+// Строки сигнатуры — независимые хеш-функции, поэтому доля совпавших строк близка к мере Жаккара.
+// Если строки зависят друг от друга, у множеств из подряд идущих id они совпадают целыми сериями
+// и оценка уходит к 0 или 1
+void TestNearDuplicateSignatureRowsAreIndependent() {
+    const std::vector<int> base = MakeTermIdRange(0, 100);
+    for (int shift = 5; shift < 100; shift += 5) {
+        const std::vector<int> shifted = MakeTermIdRange(shift, shift + 100);
+        NearDuplicateIndex index({ 64, 4, 0.8 });
+        index.Add(0, base);
+        index.Add(1, shifted);
+        ASSERT(std::abs(index.EstimateJaccard(0, 1) - ComputeJaccard(base, shifted)) < 0.1);
+    }
+}
+
+// Расстояние считается по символам UTF-8: замена кириллической буквы — одна правка
+void TestTermDistanceCountsCodePoints() {
+    const TermDictionary dictionary{ { "малако", 0 }, { "молоко", 1 }, { "мрак", 2 }, { "\xD0x", 3 }, { "\xD0\xBEx", 4 } };
+    const auto matches = FindTermsWithinDistance(dictionary, "мрлоко", 1);
+    ASSERT_EQUAL(matches.size(), 1u);
+    ASSERT_EQUAL(matches[0].term, "молоко");
+    ASSERT_EQUAL(matches[0].distance, 1);
+
+    // Некорректный байт \xD0 — отдельный символ, а у "\xD0\xBEx" он начинает букву "о"
+    const auto invalid_matches = FindTermsWithinDistance(dictionary, "оx", 0);
+    ASSERT_EQUAL(invalid_matches.size(), 1u);
+    ASSERT_EQUAL(invalid_matches[0].term, "\xD0\xBEx");
+}
+
+// Минус-слово исключает документ из всей выдачи, только если стоит на верхнем уровне выражения
+void TestMinusWordsUnderOperators() {
+    SearchServer search_server(""s);
+    search_server.AddDocument(1, "aw", DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(2, "bw", DocumentStatus::ACTUAL, { 1 });
+    search_server.AddDocument(3, "aw bw cw", DocumentStatus::ACTUAL, { 1 });
+    ASSERT_EQUAL(FindDocumentIds(search_server, "aw NOT -bw"), (std::set<int>{ 1, 2, 3 }));
+    ASSERT_EQUAL(FindDocumentIds(search_server, "aw OR (cw -bw)"), (std::set<int>{ 1, 3 }));
+    ASSERT_EQUAL(FindDocumentIds(search_server, "(aw OR cw) -bw"), (std::set<int>{ 1 }));
+    ASSERT_EQUAL(FindDocumentIds(search_server, "aw AND NOT bw"), (std::set<int>{ 1 }));
+    ASSERT_EQUAL(FindDocumentIds(search_server, "+aw -bw"), (std::set<int>{ 1 }));
+}
+
+// Пары "буква — её строчная форма" на границах диапазонов FoldChar; буквы без пары не меняются
+void TestTokenizerFoldsCase() {
+    const std::vector<std::pair<std::string, std::string>> folds = {
+        { "A", "a" }, { "Z", "z" }, { "À", "à" }, { "Þ", "þ" }, { "×", "×" }, { "ß", "ß" }, { "ÿ", "ÿ" },
+        { "Ā", "ā" }, { "İ", "İ" }, { "ĸ", "ĸ" }, { "Ĺ", "ĺ" }, { "Ň", "ň" }, { "Ŋ", "ŋ" }, { "Ÿ", "ÿ" },
+        { "Ź", "ź" }, { "Ž", "ž" }, { "ſ", "ſ" },
+        { "Ά", "ά" }, { "Έ", "έ" }, { "Ί", "ί" }, { "Ό", "ό" }, { "Ύ", "ύ" }, { "Ώ", "ώ" }, { "ΐ", "ΐ" },
+        { "Α", "α" }, { "Σ", "σ" }, { "ς", "σ" }, { "Ω", "ω" }, { "Ϊ", "ϊ" }, { "Ϋ", "ϋ" }, { "ω", "ω" },
+        { "Ѐ", "ѐ" }, { "Ё", "ё" }, { "Џ", "џ" }, { "А", "а" }, { "Я", "я" }, { "я", "я" }, { "Ѡ", "ѡ" },
+        { "Ҁ", "ҁ" }, { "Ҋ", "ҋ" }, { "Ӏ", "ӏ" }, { "Ӂ", "ӂ" }, { "Ӎ", "ӎ" }, { "Ӑ", "ӑ" }, { "Ԯ", "ԯ" },
+    };
+    const Tokenizer tokenizer;
+    WordStorage storage;
+    for (const auto& [letter, folded] : folds) {
+        ASSERT_EQUAL(tokenizer.Tokenize(letter, storage), std::vector<std::string_view>{ folded });
+    }
+}
+
+// Шарды считают IDF по общим счётчикам, поэтому выдача совпадает с одним сервером
+// и после удаления части документов
+void TestShardedServerMatchesSingleServer() {
+    const Corpus corpus = MakeTestCorpus();
+    const std::string& stop_word = corpus.dictionary.front();
+    SearchServer search_server(stop_word);
+    ShardedSearchServer sharded_server(4, stop_word);
+    // Разные рейтинги, чтобы порядок документов с равной релевантностью не зависел от реализации
+    for (size_t i = 0; i < corpus.documents.size(); ++i) {
+        const int document_id = static_cast<int>(i);
+        search_server.AddDocument(document_id, corpus.documents[i], DocumentStatus::ACTUAL, { document_id });
+        sharded_server.AddDocument(document_id, corpus.documents[i], DocumentStatus::ACTUAL, { document_id });
+    }
+
+    const auto assert_same = [&] {
+        ASSERT_EQUAL(sharded_server.GetDocumentCount(), search_server.GetDocumentCount());
+        ASSERT_EQUAL(sharded_server.FindWordsByPrefix(""), search_server.FindWordsByPrefix(""));
+        for (const std::string& query : corpus.queries) {
+            AssertSameDocuments(sharded_server.FindTopDocuments(query), search_server.FindTopDocuments(query), query);
+        }
+    };
+    assert_same();
+
+    for (size_t i = 0; i < corpus.documents.size(); i += 3) {
+        search_server.RemoveDocument(static_cast<int>(i));
+        sharded_server.RemoveDocument(static_cast<int>(i));
+    }
+    assert_same();
+
+    ASSERT_THROWS(search_server.RemoveDocument(0), std::out_of_range);
+    ASSERT_THROWS(sharded_server.RemoveDocument(0), std::out_of_range);
+    assert_same();
+}
+
+// Отмена и срок проверяются между блоками постингов, а не только перед началом запроса
+void TestAsyncSearchCancelsMidQuery() {
+    SearchServer search_server(""s);
+    for (int document_id = 0; document_id < static_cast<int>(ASYNC_POSTING_BLOCK) * 4; ++document_id) {
+        search_server.AddDocument(document_id, "aw", DocumentStatus::ACTUAL, { 1 });
+    }
+    {
+        QueryExecutor executor(1);
+        auto result = RunInterrupted(executor, search_server.FindTopDocumentsAsync(executor, "aw"s), [] {});
+        ASSERT_EQUAL(result.get().size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    }
+    {
+        QueryExecutor executor(1);
+        std::stop_source stop_source;
+        AsyncQueryOptions options;
+        options.stop_token = stop_source.get_token();
+        auto result = RunInterrupted(executor, search_server.FindTopDocumentsAsync(executor, "aw"s, options),
+            [&stop_source] { stop_source.request_stop(); });
+        ASSERT_THROWS(result.get(), QueryCancelled);
+    }
+    {
+        QueryExecutor executor(1);
+        AsyncQueryOptions options;
+        options.deadline = AsyncQueryOptions::Clock::now() + std::chrono::milliseconds(200);
+        auto result = RunInterrupted(executor, search_server.FindTopDocumentsAsync(executor, "aw"s, options),
+            [&options] { std::this_thread::sleep_until(options.deadline); });
+        ASSERT_THROWS(result.get(), QueryCancelled);
+    }
+}
+
+// Длинный запрос сопоставляется блоками слов: результат тот же, что у MatchDocument, а отмена срабатывает между блоками
+void TestAsyncMatchDocumentYieldsBetweenWordBlocks() {
+    std::string document;
+    std::string query;
+    for (size_t i = 0; i < ASYNC_MATCH_WORD_BLOCK * 4; ++i) {
+        document += " w"s + std::to_string(i);
+        // Слов в документе больше, чем в запросе, иначе сопоставление идёт по словам документа за один проход
+        if (i % 4 == 0) {
+            query += " w"s + std::to_string(i) + " q"s + std::to_string(i);
+        }
+    }
+    SearchServer search_server(""s);
+    search_server.AddDocument(1, document, DocumentStatus::BANNED, { 1 });
+    {
+        QueryExecutor executor(1);
+        auto result = RunInterrupted(executor, search_server.MatchDocumentAsync(executor, query, 1), [] {});
+        ASSERT(result.get() == search_server.MatchDocument(query, 1));
+    }
+    {
+        QueryExecutor executor(1);
+        std::stop_source stop_source;
+        AsyncQueryOptions options;
+        options.stop_token = stop_source.get_token();
+        auto result = RunInterrupted(executor, search_server.MatchDocumentAsync(executor, query, 1, options),
+            [&stop_source] { stop_source.request_stop(); });
+        ASSERT_THROWS(result.get(), QueryCancelled);
+    }
+}
+
+// При обрыве по бюджету в результат успевают попасть постинги самого редкого слова
+void TestBudgetedSearchScoresRarestTermFirst() {
+    SearchServer search_server(""s);
+    for (int document_id = 0; document_id < 100; ++document_id) {
+        search_server.AddDocument(document_id, document_id == 42 ? "common rare" : "common", DocumentStatus::ACTUAL, { document_id });
+    }
+    QueryBudget budget;
+    budget.max_postings = 1;
+    for (const auto& result : { search_server.FindTopDocuments("common rare", DocumentStatus::ACTUAL, budget),
+        search_server.FindTopDocuments("common rare", DocumentFilter{ DocumentStatus::ACTUAL }, budget, Bm25Ranker{}) }) {
+        ASSERT(result.is_partial);
+        ASSERT_EQUAL(result.documents.size(), 1u);
+        ASSERT_EQUAL(result.documents[0].id, 42);
+    }
+
+    // Без ограничения бюджетный запрос совпадает с обычным при любом ранжировщике
+    const SearchResult full = search_server.FindTopDocuments("common rare", DocumentFilter{ DocumentStatus::ACTUAL }, QueryBudget{},
+        Bm25Ranker{});
+    ASSERT(!full.is_partial);
+    AssertSameDocuments(full.documents, search_server.FindTopDocuments(std::execution::seq, "common rare",
+        DocumentFilter{ DocumentStatus::ACTUAL }, Bm25Ranker{}), "common rare");
+}
+
+// Потоки пишут каждый в своё кольцо, и сводка складывает их без потерь
+void TestRequestStatisticsAggregatesThreads() {
+    constexpr int THREAD_COUNT = 8;
+    constexpr int REQUESTS_PER_THREAD = 1000;
+    RequestStatistics statistics;
+    const auto start_time = RequestStatistics::Clock::now();
+    std::vector<std::thread> threads;
+    for (int thread_index = 0; thread_index < THREAD_COUNT; ++thread_index) {
+        threads.emplace_back([&statistics] {
+            for (int i = 0; i < REQUESTS_PER_THREAD; ++i) {
+                // Каждый четвёртый запрос пустой; задержки 5 и 1000 мкс попадают в корзины 2^3 - 1 и 2^10 - 1
+                statistics.Record(i % 4 == 0 ? 0 : 5, std::chrono::microseconds(i % 2 == 0 ? 5 : 1000));
+            }
+            });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const auto elapsed_seconds = std::chrono::duration_cast<std::chrono::seconds>(RequestStatistics::Clock::now() - start_time).count();
+
+    const RequestStatisticsSnapshot snapshot = statistics.GetSnapshot();
+    const uint64_t request_count = THREAD_COUNT * REQUESTS_PER_THREAD;
+    ASSERT_EQUAL(snapshot.request_count, request_count);
+    ASSERT_EQUAL(snapshot.no_result_count, request_count / 4);
+    ASSERT(std::abs(snapshot.empty_result_rate - 0.25) < EPSILON);
+    // QPS — число запросов, делённое на целое число секунд, прошедших с создания статистики
+    const double covered_seconds = request_count / snapshot.queries_per_second;
+    ASSERT(std::abs(covered_seconds - std::round(covered_seconds)) < EPSILON);
+    ASSERT(covered_seconds >= 1.0 && covered_seconds <= elapsed_seconds + 2.0);
+    ASSERT_EQUAL(snapshot.latency.GetCount(), request_count);
+    ASSERT_EQUAL(snapshot.latency.GetBucketCount(Histogram::GetBucketIndex(7)), request_count / 2);
+    ASSERT_EQUAL(snapshot.latency.GetBucketCount(Histogram::GetBucketIndex(1023)), request_count / 2);
+}
+
+std::vector<int> GetDocumentIds(const std::vector<Document>& documents) {
+    std::vector<int> document_ids;
+    for (const Document& document : documents) {
+        document_ids.push_back(document.id);
+    }
+    return document_ids;
+}
+
+// Обход курсором проходит выдачу ровно по одному разу в порядке IsRankedBefore,
+// а страница по номеру совпадает со страницей курсора
+void TestPaginationWalksRankedResultsOnce() {
+    constexpr int DOCUMENT_COUNT = 80;
+    constexpr int MATCHING_COUNT = 60;
+    constexpr size_t PAGE_SIZE = 7;
+    SearchServer search_server(""s);
+    // Релевантность зависит только от числа слов-заполнителей, рейтинг — от чётности id,
+    // так что у многих документов совпадают и релевантность, и рейтинг
+    const auto filler_count = [](int document_id) { return document_id % 4; };
+    for (int document_id = 0; document_id < DOCUMENT_COUNT; ++document_id) {
+        std::string text = document_id < MATCHING_COUNT ? "aw"s : "cw"s;
+        for (int i = 0; i < filler_count(document_id); ++i) {
+            text += " bw"s;
+        }
+        search_server.AddDocument(document_id, text, DocumentStatus::ACTUAL, { document_id % 2 });
+    }
+    const auto predicate = [](int document_id, DocumentStatus, int) { return document_id % 5 != 0; };
+
+    std::vector<int> expected_ids;
+    for (int document_id = 0; document_id < MATCHING_COUNT; ++document_id) {
+        if (predicate(document_id, DocumentStatus::ACTUAL, 0)) {
+            expected_ids.push_back(document_id);
+        }
+    }
+    std::sort(expected_ids.begin(), expected_ids.end(), [&filler_count](int lhs, int rhs) {
+        return std::tuple(filler_count(lhs), -(lhs % 2), lhs) < std::tuple(filler_count(rhs), -(rhs % 2), rhs);
+        });
+
+    std::vector<Document> walked;
+    std::optional<SearchCursor> cursor;
+    size_t page_index = 0;
+    do {
+        const SearchPage page = search_server.FindTopDocumentsPage(std::execution::seq, "aw", predicate, PAGE_SIZE, cursor);
+        ASSERT(!page.documents.empty());
+        AssertSameDocuments(search_server.FindTopDocumentsPageByIndex(std::execution::seq, "aw", predicate, page_index, PAGE_SIZE),
+            page.documents, "aw");
+        AssertSameDocuments(search_server.FindTopDocumentsPageByIndex(std::execution::par, "aw", predicate, page_index, PAGE_SIZE),
+            page.documents, "aw");
+        walked.insert(walked.end(), page.documents.begin(), page.documents.end());
+        cursor = page.next_cursor;
+        ++page_index;
+    } while (cursor);
+    ASSERT_EQUAL(GetDocumentIds(walked), expected_ids);
+    ASSERT(search_server.FindTopDocumentsPageByIndex(std::execution::seq, "aw", predicate, page_index, PAGE_SIZE).empty());
+}
+
+void AssertSameSet(const DocumentSet& actual, const std::set<int>& expected) {
+    ASSERT_EQUAL(actual.size(), expected.size());
+    ASSERT_EQUAL(std::vector<int>(actual.begin(), actual.end()), std::vector<int>(expected.begin(), expected.end()));
+    for (const int document_id : expected) {
+        ASSERT(actual.Contains(document_id));
+    }
+}
+
+// Каждое step-е число из [first, last)
+std::set<int> MakeIdRange(int first, int last, int step) {
+    std::set<int> document_ids;
+    for (int document_id = first; document_id < last; document_id += step) {
+        document_ids.insert(document_id);
+    }
+    return document_ids;
+}
+
+DocumentSet MakeDocumentSet(const std::set<int>& document_ids) {
+    DocumentSet documents;
+    for (const int document_id : document_ids) {
+        documents.Add(document_id);
+    }
+    return documents;
+}
+
+// Контейнер становится битовой картой на ARRAY_LIMIT + 1 элементе и массивом обратно, когда их снова ARRAY_LIMIT
+void TestDocumentSetSwitchesContainerForm() {
+    const int limit = static_cast<int>(DocumentSet::ARRAY_LIMIT);
+    DocumentSet documents;
+    std::set<int> expected;
+    for (int i = 0; i <= limit; ++i) {
+        ASSERT(documents.Add(i * 2));
+        expected.insert(i * 2);
+        if (i >= limit - 1) {
+            AssertSameSet(documents, expected);
+            ASSERT(!documents.Contains(i * 2 + 1));
+        }
+    }
+    ASSERT(!documents.Add(limit * 2));
+    for (int i = limit; i >= limit - 2; --i) {
+        ASSERT(documents.Remove(i * 2));
+        expected.erase(i * 2);
+        AssertSameSet(documents, expected);
+    }
+    ASSERT(!documents.Remove(limit * 2));
+    ASSERT(!documents.Remove(1));
+}
+
+// Id по обе стороны границы 2^16 попадают в разные контейнеры, а итератор переходит между ними,
+// пропуская ключи без контейнеров и хвост битовой карты без элементов
+void TestDocumentSetCrossesChunkBoundaries() {
+    const int chunk = 1 << 16;
+    std::set<int> expected = MakeIdRange(chunk - 5, chunk + 5, 1);
+    expected.insert(chunk * 3 - 1);
+    expected.insert(chunk * 3);
+    expected.insert(chunk * 7 + 100);
+    AssertSameSet(MakeDocumentSet(expected), expected);
+
+    // Битовая карта, у которой за последним элементом тысячи пустых слов, и массив через несколько пустых ключей
+    std::set<int> dense = MakeIdRange(0, 3 * (static_cast<int>(DocumentSet::ARRAY_LIMIT) + 1), 3);
+    dense.insert(chunk * 5);
+    AssertSameSet(MakeDocumentSet(dense), dense);
+
+    DocumentSet documents = MakeDocumentSet(expected);
+    for (const int document_id : MakeIdRange(chunk, chunk + 5, 1)) {
+        ASSERT(documents.Remove(document_id));
+        expected.erase(document_id);
+    }
+    AssertSameSet(documents, expected);
+}
+
+// Операции над всеми сочетаниями массивов и битовых карт сверяются с std::set, в том числе
+// когда результат меняет форму контейнера или опустошает его
+void TestDocumentSetOperationsMatchStdSet() {
+    const int chunk = 1 << 16;
+    const int dense_size = static_cast<int>(DocumentSet::ARRAY_LIMIT) + 1000;
+    std::vector<std::set<int>> operands = {
+        {},
+        MakeIdRange(0, 700, 7),
+        MakeIdRange(0, dense_size * 3, 3),
+        MakeIdRange(0, dense_size * 5, 5),
+        MakeIdRange(chunk, chunk + 500, 2),
+    };
+    // Массив в одном контейнере и битовая карта в другом, с пустым ключом между ними
+    std::set<int> mixed = MakeIdRange(0, 100, 1);
+    mixed.merge(MakeIdRange(chunk * 2, chunk * 2 + dense_size, 1));
+    operands.push_back(mixed);
+
+    for (const auto& lhs : operands) {
+        for (const auto& rhs : operands) {
+            const DocumentSet lhs_set = MakeDocumentSet(lhs);
+            const DocumentSet rhs_set = MakeDocumentSet(rhs);
+            std::set<int> intersection;
+            std::set_intersection(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), std::inserter(intersection, intersection.end()));
+            std::set<int> union_ids;
+            std::set_union(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), std::inserter(union_ids, union_ids.end()));
+            std::set<int> difference;
+            std::set_difference(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), std::inserter(difference, difference.end()));
+
+            AssertSameSet(lhs_set & rhs_set, intersection);
+            AssertSameSet(lhs_set | rhs_set, union_ids);
+            AssertSameSet(lhs_set - rhs_set, difference);
+
+            DocumentSet result = lhs_set;
+            result &= rhs_set;
+            AssertSameSet(result, intersection);
+            result = lhs_set;
+            result |= rhs_set;
+            AssertSameSet(result, union_ids);
+            result = lhs_set;
+            result -= rhs_set;
+            AssertSameSet(result, difference);
+        }
+    }
+}
+
+// Запрос для сверки с полным перебором: слова, которые дают релевантность и исключают документ,
+// и условие выражения на множество слов документа
+struct NaiveQuery {
+    std::string raw_query;
+    std::vector<std::string> plus_words;
+    std::vector<std::string> minus_words;
+    std::function<bool(const std::set<std::string>&)> constraint = [](const std::set<std::string>&) { return true; };
+};
+
+std::vector<Document> FindDocumentsByScan(const std::vector<std::string>& texts, const std::vector<DocumentStatus>& statuses,
+    const std::vector<int>& ratings, const NaiveQuery& query, DocumentStatus status) {
+    std::vector<std::vector<std::string>> document_words;
+    for (const std::string& text : texts) {
+        document_words.push_back(SplitIntoWords(text));
+    }
+    const auto document_freq = [&document_words](const std::string& word) {
+        return std::count_if(document_words.begin(), document_words.end(), [&word](const std::vector<std::string>& words) {
+            return std::find(words.begin(), words.end(), word) != words.end();
+            });
+    };
+
+    std::vector<Document> documents;
+    for (size_t document_id = 0; document_id < texts.size(); ++document_id) {
+        const std::vector<std::string>& words = document_words[document_id];
+        const std::set<std::string> word_set(words.begin(), words.end());
+        if (statuses[document_id] != status || !query.constraint(word_set)) {
+            continue;
+        }
+        if (std::any_of(query.minus_words.begin(), query.minus_words.end(),
+            [&word_set](const std::string& word) { return word_set.count(word) > 0; })) {
+            continue;
+        }
+        bool is_matched = false;
+        double relevance = 0.0;
+        for (const std::string& word : query.plus_words) {
+            if (word_set.count(word) == 0) {
+                continue;
+            }
+            is_matched = true;
+            const double term_freq = std::count(words.begin(), words.end(), word) * 1.0 / words.size();
+            relevance += term_freq * std::log(texts.size() * 1.0 / document_freq(word));
+        }
+        if (is_matched) {
+            documents.push_back({ static_cast<int>(document_id), relevance, ratings[document_id] });
+        }
+    }
+    std::sort(documents.begin(), documents.end(), IsRankedBefore);
+    return documents;
+}
+
+// Каждая стратегия плана — TERM_AT_A_TIME, DOCUMENT_AT_A_TIME с поиском и со слиянием минус-списков, EMPTY —
+// находит те же документы с той же релевантностью, что и полный перебор
+void TestQueryPlansMatchFullScan() {
+    constexpr int DOCUMENT_COUNT = 200;
+    std::vector<std::string> texts;
+    std::vector<DocumentStatus> statuses;
+    std::vector<int> ratings;
+    SearchServer search_server(""s);
+    for (int document_id = 0; document_id < DOCUMENT_COUNT; ++document_id) {
+        std::string text = "common"s;
+        for (const auto& [word, period] : std::vector<std::pair<std::string, int>>{ { "aw", 2 }, { "bw", 3 }, { "rw", 50 } }) {
+            if (document_id % period == 0) {
+                text += " "s + word;
+            }
+        }
+        for (int i = 0; i < document_id % 5; ++i) {
+            text += " fw"s;
+        }
+        texts.push_back(text);
+        // Заблокированных документов меньше, чем постингов на плюс-слово: фильтр по ним выбирает DOCUMENT_AT_A_TIME
+        statuses.push_back(document_id % 40 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL);
+        ratings.push_back(document_id % 7);
+        search_server.AddDocument(document_id, text, statuses.back(), { ratings.back() });
+    }
+
+    const auto has = [](std::string word) {
+        return [word](const std::set<std::string>& words) { return words.count(word) > 0; };
+    };
+    const std::vector<NaiveQuery> queries = {
+        // С фильтром BANNED кандидатов мало, а список минус-слова длинный: кандидаты ищутся в нём поштучно
+        { "aw -bw", { "aw" }, { "bw" } },
+        // Список минус-слова короче списка кандидатов: он сливается с ними
+        { "aw bw -rw", { "aw", "bw" }, { "rw" } },
+        // Выражение пропускает мало документов: DOCUMENT_AT_A_TIME по ним
+        { "aw AND rw", { "aw", "rw" }, {}, [has](const auto& words) { return has("aw")(words) && has("rw")(words); } },
+        // Выражение пропускает много документов: TERM_AT_A_TIME с проверкой по ним
+        { "(aw OR bw) AND common", { "aw", "bw", "common" }, {},
+            [has](const auto& words) { return has("aw")(words) || has("bw")(words); } },
+        // EMPTY: ни одного плюс-слова нет в индексе
+        { "zw yw", { "zw", "yw" }, {} },
+        // EMPTY: минус-слово есть во всех документах
+        { "aw -common", { "aw" }, { "common" } },
+        // EMPTY: в выражении слово, которого нет в индексе
+        { "aw AND zw", { "aw", "zw" }, {}, has("zw") },
+        // EMPTY: выражение невыполнимо, хотя все его слова есть в индексе
+        { "rw AND NOT aw", { "rw" }, {}, [has](const auto& words) { return has("rw")(words) && !has("aw")(words); } },
+        // EMPTY после исключения: все отобранные фильтром BANNED документы содержат минус-слово
+        { "bw -aw", { "bw" }, { "aw" } },
+    };
+    // Предикат-лямбда всегда считается по спискам плюс-слов, DocumentFilter может отобрать кандидатов по статусу
+    for (const NaiveQuery& query : queries) {
+        for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::BANNED }) {
+            const std::vector<Document> expected = FindDocumentsByScan(texts, statuses, ratings, query, status);
+            const auto lambda = [status](int, DocumentStatus document_status, int) { return document_status == status; };
+            const size_t page_size = DOCUMENT_COUNT;
+            AssertSameDocuments(search_server.FindTopDocumentsPage(std::execution::seq, query.raw_query, DocumentFilter{ status }, page_size).documents,
+                expected, query.raw_query);
+            AssertSameDocuments(search_server.FindTopDocumentsPage(std::execution::par, query.raw_query, DocumentFilter{ status }, page_size).documents,
+                expected, query.raw_query);
+            AssertSameDocuments(search_server.FindTopDocumentsPage(std::execution::seq, query.raw_query, lambda, page_size).documents,
+                expected, query.raw_query);
+            AssertSameDocuments(search_server.FindTopDocumentsPage(std::execution::par, query.raw_query, lambda, page_size).documents,
+                expected, query.raw_query);
+        }
+    }
+}
+
+} // namespace
+
+void TestSearchServer() {
+    TestRunner tr;
+    RUN_TEST(tr, TestNearDuplicateSignatureRowsAreIndependent);
+    RUN_TEST(tr, TestTermDistanceCountsCodePoints);
+    RUN_TEST(tr, TestMinusWordsUnderOperators);
+    RUN_TEST(tr, TestTokenizerFoldsCase);
+    RUN_TEST(tr, TestShardedServerMatchesSingleServer);
+    RUN_TEST(tr, TestAsyncSearchCancelsMidQuery);
+    RUN_TEST(tr, TestAsyncMatchDocumentYieldsBetweenWordBlocks);
+    RUN_TEST(tr, TestBudgetedSearchScoresRarestTermFirst);
+    RUN_TEST(tr, TestRequestStatisticsAggregatesThreads);
+    RUN_TEST(tr, TestPaginationWalksRankedResultsOnce);
+    RUN_TEST(tr, TestDocumentSetSwitchesContainerForm);
+    RUN_TEST(tr, TestDocumentSetCrossesChunkBoundaries);
+    RUN_TEST(tr, TestDocumentSetOperationsMatchStdSet);
+    RUN_TEST(tr, TestQueryPlansMatchFullScan);
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+// Модульные тесты сервера; при ошибке печатают упавшие проверки и завершают программу с кодом 1
+void TestSearchServer();
@@ -0,0 +1,107 @@
+#include "sharded_search_server.h"
+
+size_t ShardedSearchServer::GetShardCount() const noexcept {
+    return shards_.size();
+}
+
+size_t ShardedSearchServer::GetShardNode(size_t shard_index) const noexcept {
+    return node_executors_.empty() ? 0 : node_executors_[shard_nodes_[shard_index]]->GetNode();
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+    return document_count_;
+}
+
+void ShardedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    const size_t index = GetShardIndex(document_id);
+    SearchServer& shard = shards_[index];
+    if (node_executors_.empty()) {
+        shard.AddDocument(document_id, document, status, ratings);
+    }
+    else {
+        node_executors_[shard_nodes_[index]]->Submit([&] { shard.AddDocument(document_id, document, status, ratings); }).get();
+    }
+    RegisterDocument(shard, document_id);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    SearchServer& shard = shards_[GetShardIndex(document_id)];
+    // Неизвестный id, как и у SearchServer::RemoveDocument, — std::out_of_range, до изменения счётчиков
+    const int document_length = shard.GetDocumentLength(document_id);
+    for (const auto& [word, _] : shard.GetWordFrequencies(document_id)) {
+        const auto it = word_document_counts_.find(word);
+        if (--it->second == 0) {
+            word_document_counts_.erase(it);
+        }
+    }
+    total_document_length_ -= document_length;
+    shard.RemoveDocument(document_id);
+    --document_count_;
+}
+
+void ShardedSearchServer::EnablePositionalIndex() {
+    // Позиции строятся на потоках узла шарда, чтобы лечь в его память
+    ForEachShard(std::execution::par, [this](size_t index) {
+        shards_[index].EnablePositionalIndex();
+        });
+}
+
+void ShardedSearchServer::EnableFuzzyMatching(FuzzyMatchOptions options) {
+    if (options.max_edits < 1) {
+        throw std::invalid_argument("Допустимое число опечаток должно быть положительным"s);
+    }
+    fuzzy_options_ = options;
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(std::execution::seq, raw_query, status);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query) const {
+    return FindTopDocuments(std::execution::seq, raw_query, DocumentStatus::ACTUAL);
+}
+
+SearchServer::match_tuple ShardedSearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
+    return shards_[GetShardIndex(document_id)].MatchDocument(raw_query, document_id);
+}
+
+WordFrequenciesView ShardedSearchServer::GetWordFrequencies(int document_id) const {
+    return shards_[GetShardIndex(document_id)].GetWordFrequencies(document_id);
+}
+
+std::vector<std::string_view> ShardedSearchServer::FindWordsByPrefix(std::string_view prefix, size_t limit) const {
+    return FindTermsByPrefix(word_document_counts_, prefix, limit);
+}
+
+size_t ShardedSearchServer::GetShardIndex(int document_id) const noexcept {
+    // Перемешиваем биты id, чтобы последовательные id расходились по разным шардам равномерно
+    const uint64_t hash = static_cast<uint64_t>(static_cast<uint32_t>(document_id)) * 0x9E3779B97F4A7C15ull;
+    return static_cast<size_t>((hash >> 32) % shards_.size());
+}
+
+void ShardedSearchServer::RegisterDocument(const SearchServer& shard, int document_id) {
+    for (const auto& [word, _] : shard.GetWordFrequencies(document_id)) {
+        const auto it = word_document_counts_.find(word);
+        if (it == word_document_counts_.end()) {
+            word_document_counts_.emplace(std::string(word), 1);
+        }
+        else {
+            ++it->second;
+        }
+    }
+    total_document_length_ += shard.GetDocumentLength(document_id);
+    ++document_count_;
+}
+
+TermStatistics ShardedSearchServer::GetTermStatistics(std::string_view word) const {
+    const auto it = word_document_counts_.find(word);
+    return { document_count_,
+             it == word_document_counts_.end() ? 0 : it->second,
+             document_count_ == 0 ? 0.0 : static_cast<double>(total_document_length_) / document_count_ };
+}
+
+void ShardedSearchServer::SelectTopDocuments(std::vector<Document>& documents) {
+    const size_t top_count = std::min(documents.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    std::partial_sort(documents.begin(), documents.begin() + top_count, documents.end(), IsMoreRelevant);
+    documents.resize(top_count);
+}
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <execution>
+#include <future>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "numa_executor.h"
+#include "search_server.h"
+
+enum class ShardPlacement {
+    ANY,
+    // Шарды распределяются по NUMA-узлам; индексация и поиск по шарду идут на потоках его узла
+    NUMA_LOCAL
+};
+
+class ShardedSearchServer {
+public:
+    struct DocumentEntry {
+        int id;
+        std::string_view text;
+        DocumentStatus status;
+        std::vector<int> ratings;
+    };
+
+    // Все шарды делят текст одним токенизатором, иначе общий словарь шардов разошёлся бы с их индексами
+    template <typename StringCollection>
+    ShardedSearchServer(size_t shard_count, const StringCollection& stop_words, ShardPlacement placement = ShardPlacement::ANY,
+        TokenizerOptions tokenizer_options = {});
+
+    explicit ShardedSearchServer(size_t shard_count) : ShardedSearchServer(shard_count, ""s) {}
+
+    size_t GetShardCount() const noexcept;
+
+    // Номер NUMA-узла, на потоках которого работает шард; 0 при ShardPlacement::ANY
+    size_t GetShardNode(size_t shard_index) const noexcept;
+
+    int GetDocumentCount() const;
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    // Документы раскладываются по шардам заранее, и каждый шард индексирует свою часть независимо
+    template <typename ExecutionPolicy>
+    void AddDocuments(ExecutionPolicy&& policy, const std::vector<DocumentEntry>& documents);
+
+    void RemoveDocument(int document_id);
+
+    // Фразы в кавычках проверяются каждым шардом по его собственному позиционному индексу
+    void EnablePositionalIndex();
+
+    // Редкие слова запроса дополняются близкими словами общего словаря шардов
+    void EnableFuzzyMatching(FuzzyMatchOptions options = {});
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query,
+        DocumentPredicate document_predicate) const;
+
+    template <typename ExecutionPolicy, typename DocumentPredicate, typename Ranker>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query,
+        DocumentPredicate document_predicate, const Ranker& ranker) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query) const;
+
+    SearchServer::match_tuple MatchDocument(std::string_view raw_query, int document_id) const;
+
+    WordFrequenciesView GetWordFrequencies(int document_id) const;
+
+    std::vector<std::string_view> FindWordsByPrefix(std::string_view prefix,
+        size_t limit = std::numeric_limits<size_t>::max()) const;
+
+private:
+    std::vector<SearchServer> shards_;
+    std::vector<size_t> shard_indexes_;
+    // Номер пула в node_executors_, а не номер узла: узлы могут нумероваться с пропусками
+    std::vector<size_t> shard_nodes_;
+    // Документная частота слова и длины документов по всем шардам: вес слова считается одинаково,
+    // где бы ни лежал документ
+    TermDictionary word_document_counts_;
+    int document_count_ = 0;
+    uint64_t total_document_length_ = 0;
+    std::optional<FuzzyMatchOptions> fuzzy_options_;
+    // Пусто при ShardPlacement::ANY. Объявлены после шардов, чтобы остановиться раньше них
+    std::vector<std::unique_ptr<NumaNodeExecutor>> node_executors_;
+
+    size_t GetShardIndex(int document_id) const noexcept;
+
+    template <typename ExecutionPolicy, typename Function>
+    void ForEachShard(ExecutionPolicy&& policy, Function function) const;
+
+    void RegisterDocument(const SearchServer& shard, int document_id);
+
+    TermStatistics GetTermStatistics(std::string_view word) const;
+
+    static void SelectTopDocuments(std::vector<Document>& documents);
+};
+
+template <typename StringCollection>
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, const StringCollection& stop_words, ShardPlacement placement,
+    TokenizerOptions tokenizer_options) {
+    if (shard_count == 0) {
+        throw std::invalid_argument("Количество шардов должно быть положительным"s);
+    }
+    const std::vector<size_t> nodes = placement == ShardPlacement::NUMA_LOCAL ? GetNumaNodes() : std::vector<size_t>{ 0 };
+    if (placement == ShardPlacement::NUMA_LOCAL) {
+        for (const size_t node : nodes) {
+            node_executors_.push_back(std::make_unique<NumaNodeExecutor>(node));
+        }
+    }
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.emplace_back(stop_words, tokenizer_options);
+        shard_indexes_.push_back(i);
+        shard_nodes_.push_back(i % nodes.size());
+    }
+}
+
+template <typename ExecutionPolicy, typename Function>
+void ShardedSearchServer::ForEachShard(ExecutionPolicy&& policy, Function function) const {
+    if (node_executors_.empty()) {
+        std::for_each(policy, shard_indexes_.begin(), shard_indexes_.end(), function);
+        return;
+    }
+    std::vector<std::future<void>> results;
+    results.reserve(shards_.size());
+    for (size_t index : shard_indexes_) {
+        results.push_back(node_executors_[shard_nodes_[index]]->Submit([&function, index] { function(index); }));
+    }
+    for (auto& result : results) {
+        result.wait();
+    }
+    for (auto& result : results) {
+        result.get();
+    }
+}
+
+template <typename ExecutionPolicy>
+void ShardedSearchServer::AddDocuments(ExecutionPolicy&& policy, const std::vector<DocumentEntry>& documents) {
+    std::vector<std::vector<const DocumentEntry*>> shard_documents(shards_.size());
+    for (const DocumentEntry& document : documents) {
+        shard_documents[GetShardIndex(document.id)].push_back(&document);
+    }
+
+    std::vector<std::vector<int>> added_ids(shards_.size());
+    std::vector<std::exception_ptr> errors(shards_.size());
+    ForEachShard(policy, [&](size_t index) {
+        try {
+            for (const DocumentEntry* document : shard_documents[index]) {
+                shards_[index].AddDocument(document->id, document->text, document->status, document->ratings);
+                added_ids[index].push_back(document->id);
+            }
+        }
+        catch (...) {
+            errors[index] = std::current_exception();
+        }
+        });
+
+    for (size_t index = 0; index < shards_.size(); ++index) {
+        for (int document_id : added_ids[index]) {
+            RegisterDocument(shards_[index], document_id);
+        }
+    }
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
+    return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query,
+    DocumentPredicate document_predicate) const {
+    return FindTopDocuments(policy, raw_query, document_predicate, TfIdfRanker{});
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate, typename Ranker>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query,
+    DocumentPredicate document_predicate, const Ranker& ranker) const {
+    // Стоп-слова у всех шардов общие, поэтому запрос разбирается один раз, а префиксы раскрываются по общему словарю
+    SearchServer::Query query = shards_.front().ParseQuery(raw_query, word_document_counts_);
+    if (fuzzy_options_) {
+        SearchServer::ExpandFuzzyWords(query, word_document_counts_, *fuzzy_options_, [this](std::string_view word) {
+            const auto it = word_document_counts_.find(word);
+            return it == word_document_counts_.end() ? 0 : it->second;
+            });
+    }
+    const auto term_statistics = [this](std::string_view word) { return GetTermStatistics(word); };
+
+    std::vector<std::vector<Document>> shard_results(shards_.size());
+    ForEachShard(policy, [this, &query, &document_predicate, &term_statistics, &ranker, &shard_results](size_t index) {
+        auto documents = shards_[index].FindAllDocuments(std::execution::seq, query, document_predicate, term_statistics, ranker);
+        SelectTopDocuments(documents);
+        shard_results[index] = std::move(documents);
+        });
+
+    std::vector<Document> matched_documents;
+    for (const auto& documents : shard_results) {
+        matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
+    }
+    SelectTopDocuments(matched_documents);
+    return matched_documents;
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(policy, raw_query, DocumentFilter{ status });
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query) const {
+    return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
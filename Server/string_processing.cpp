@@ -35,7 +35,8 @@ std::vector<std::string_view> SplitIntoWordsView(std::string_view str) {
 }
 
 bool IsValidWord(const std::string_view& word) {
+    // Табуляции и переводы строк делят слова, как пробел, остальные управляющие символы запрещены
     return std::none_of(word.begin(), word.end(), [](char c) {
-        return c >= '\0' && c < ' ';
+        return c >= '\0' && c < ' ' && (c < '\t' || c > '\r');
         });
 }
\ No newline at end of file
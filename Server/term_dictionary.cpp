@@ -0,0 +1,102 @@
+#include "term_dictionary.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "tokenizer.h"
+
+std::vector<std::string_view> FindTermsByPrefix(const TermDictionary& dictionary, std::string_view prefix, size_t limit) {
+    std::vector<std::string_view> terms;
+    for (auto term = dictionary.lower_bound(prefix);
+        term != dictionary.end() && terms.size() < limit && term->first.starts_with(prefix); ++term) {
+        terms.push_back(term->first);
+    }
+    return terms;
+}
+
+namespace {
+
+// Первое слово словаря после всех слов, начинающихся с prefix
+TermDictionary::const_iterator SkipPrefix(const TermDictionary& dictionary, std::string_view prefix) {
+    std::string next_prefix(prefix);
+    while (!next_prefix.empty() && static_cast<unsigned char>(next_prefix.back()) == 0xFF) {
+        next_prefix.pop_back();
+    }
+    if (next_prefix.empty()) {
+        return dictionary.end();
+    }
+    ++next_prefix.back();
+    return dictionary.lower_bound(next_prefix);
+}
+
+} // namespace
+
+std::vector<TermMatch> FindTermsWithinDistance(const TermDictionary& dictionary, std::string_view word, int max_distance) {
+    std::vector<TermMatch> matches;
+    std::u32string word_chars;
+    for (size_t position = 0; position < word.size();) {
+        const auto [code, size] = DecodeUtf8Char(word, position);
+        word_chars += code;
+        position += size;
+    }
+    // rows[i] — расстояния от префиксов word до первых i символов текущего слова словаря
+    std::vector<std::vector<int>> rows(1, std::vector<int>(word_chars.size() + 1));
+    for (size_t j = 0; j <= word_chars.size(); ++j) {
+        rows[0][j] = static_cast<int>(j);
+    }
+    // Символы текущего и предыдущего слова словаря и смещения концов символов текущего слова в байтах:
+    // по ним пропускаются слова с неподходящим префиксом
+    std::u32string term_chars;
+    std::u32string previous_chars;
+    std::vector<size_t> char_ends;
+    auto term = dictionary.begin();
+    while (term != dictionary.end()) {
+        const std::string_view text = term->first;
+        previous_chars.swap(term_chars);
+        term_chars.clear();
+        char_ends.clear();
+        for (size_t position = 0; position < text.size();) {
+            const auto [code, size] = DecodeUtf8Char(text, position);
+            term_chars += code;
+            position += size;
+            char_ends.push_back(position);
+        }
+        size_t common_length = 0;
+        while (common_length < rows.size() - 1 && common_length < term_chars.size() && common_length < previous_chars.size()
+            && term_chars[common_length] == previous_chars[common_length]) {
+            ++common_length;
+        }
+        rows.resize(common_length + 1);
+
+        bool is_pruned = false;
+        for (size_t i = common_length; i < term_chars.size(); ++i) {
+            const std::vector<int>& row = rows.back();
+            std::vector<int> next_row(word_chars.size() + 1);
+            next_row[0] = row[0] + 1;
+            int row_min = next_row[0];
+            for (size_t j = 1; j <= word_chars.size(); ++j) {
+                next_row[j] = std::min({ row[j] + 1, next_row[j - 1] + 1, row[j - 1] + (term_chars[i] == word_chars[j - 1] ? 0 : 1) });
+                row_min = std::min(row_min, next_row[j]);
+            }
+            rows.push_back(std::move(next_row));
+            if (row_min > max_distance) {
+                // Некорректный байт у другого слова с теми же байтами может оказаться частью верного
+                // символа, поэтому после такого префикса слова пропускаются по одному
+                const bool has_invalid_byte = std::any_of(term_chars.begin(), term_chars.begin() + i + 1,
+                    [](char32_t code) { return code >= INVALID_UTF8_BYTE; });
+                term = has_invalid_byte ? std::next(term) : SkipPrefix(dictionary, text.substr(0, char_ends[i]));
+                is_pruned = true;
+                break;
+            }
+        }
+        if (is_pruned) {
+            continue;
+        }
+        const int distance = rows.back()[word_chars.size()];
+        if (distance <= max_distance) {
+            matches.push_back({ text, distance });
+        }
+        ++term;
+    }
+    return matches;
+}
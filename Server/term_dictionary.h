@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Словарь слов индекса: значение — id слова у SearchServer или число документов со словом у
+// ShardedSearchServer. Он упорядочен по тексту, поэтому слова с общим префиксом лежат подряд
+// и находятся одним спуском по дереву, без просмотра всего словаря
+using TermDictionary = std::map<std::string, int, std::less<>>;
+
+// Слова словаря, начинающиеся с prefix, в порядке словаря, но не больше limit
+std::vector<std::string_view> FindTermsByPrefix(const TermDictionary& dictionary, std::string_view prefix,
+    size_t limit = std::numeric_limits<size_t>::max());
+
+struct TermMatch {
+    std::string_view term;
+    int distance;
+};
+
+// Слова словаря на расстоянии Левенштейна не больше max_distance от word. Расстояние считается по символам
+// UTF-8, так что замена кириллической буквы — одна правка, а не две.
+// Словарь обходится как префиксное дерево: строки динамики общего с предыдущим словом префикса
+// переиспользуются, а все слова с префиксом, который уже не может уложиться в max_distance, пропускаются
+std::vector<TermMatch> FindTermsWithinDistance(const TermDictionary& dictionary, std::string_view word, int max_distance);
@@ -0,0 +1,258 @@
+#include "tokenizer.h"
+
+namespace {
+
+constexpr char32_t INVALID_CODE_POINT = 0xFFFFFFFF;
+
+struct DecodedChar {
+    char32_t code;
+    size_t size;
+};
+
+// Декодирует символ UTF-8, начинающийся не с байта ASCII. Некорректная, обрезанная или избыточно
+// длинная последовательность и суррогаты дают INVALID_CODE_POINT длиной в один байт
+DecodedChar DecodeChar(std::string_view text, size_t position) noexcept {
+    const auto lead = static_cast<unsigned char>(text[position]);
+    size_t size = 0;
+    char32_t code = 0;
+    char32_t min_code = 0;
+    if ((lead & 0xE0) == 0xC0) {
+        size = 2;
+        code = lead & 0x1F;
+        min_code = 0x80;
+    }
+    else if ((lead & 0xF0) == 0xE0) {
+        size = 3;
+        code = lead & 0x0F;
+        min_code = 0x800;
+    }
+    else if ((lead & 0xF8) == 0xF0) {
+        size = 4;
+        code = lead & 0x07;
+        min_code = 0x10000;
+    }
+    else {
+        return { INVALID_CODE_POINT, 1 };
+    }
+    if (text.size() - position < size) {
+        return { INVALID_CODE_POINT, 1 };
+    }
+    for (size_t i = 1; i < size; ++i) {
+        const auto byte = static_cast<unsigned char>(text[position + i]);
+        if ((byte & 0xC0) != 0x80) {
+            return { INVALID_CODE_POINT, 1 };
+        }
+        code = (code << 6) | (byte & 0x3F);
+    }
+    if (code < min_code || code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF)) {
+        return { INVALID_CODE_POINT, 1 };
+    }
+    return { code, size };
+}
+
+void AppendChar(std::string& text, char32_t code) {
+    if (code < 0x80) {
+        text += static_cast<char>(code);
+    }
+    else if (code < 0x800) {
+        text += static_cast<char>(0xC0 | (code >> 6));
+        text += static_cast<char>(0x80 | (code & 0x3F));
+    }
+    else if (code < 0x10000) {
+        text += static_cast<char>(0xE0 | (code >> 12));
+        text += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        text += static_cast<char>(0x80 | (code & 0x3F));
+    }
+    else {
+        text += static_cast<char>(0xF0 | (code >> 18));
+        text += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+        text += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        text += static_cast<char>(0x80 | (code & 0x3F));
+    }
+}
+
+bool IsAsciiSpace(char c) noexcept {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+// Знаки препинания и символы ASCII, кроме '_': он бывает частью идентификаторов
+bool IsAsciiPunctuation(char c) noexcept {
+    return (c >= '!' && c <= '/') || (c >= ':' && c <= '@') || (c >= '[' && c <= '^') || c == '`' || (c >= '{' && c <= '~');
+}
+
+// Пробельные символы Unicode за пределами ASCII
+bool IsUnicodeSpace(char32_t code) noexcept {
+    return code == 0x85 || code == 0xA0 || code == 0x1680 || (code >= 0x2000 && code <= 0x200A)
+        || code == 0x2028 || code == 0x2029 || code == 0x202F || code == 0x205F || code == 0x3000;
+}
+
+// Знаки препинания Latin-1, блока General Punctuation, CJK и полноширинные знаки ASCII
+bool IsUnicodePunctuation(char32_t code) noexcept {
+    if (code < 0x2000) {
+        return code == 0xA1 || code == 0xA7 || code == 0xAB || code == 0xB6 || code == 0xB7 || code == 0xBB || code == 0xBF;
+    }
+    if (code < 0x3000) {
+        return code >= 0x2010 && code <= 0x205E;
+    }
+    if (code < 0xFF00) {
+        return (code >= 0x3001 && code <= 0x3003) || (code >= 0x3008 && code <= 0x301F);
+    }
+    return (code >= 0xFF01 && code <= 0xFF0F) || (code >= 0xFF1A && code <= 0xFF20) || (code >= 0xFF3B && code <= 0xFF3E)
+        || code == 0xFF40 || (code >= 0xFF5B && code <= 0xFF65);
+}
+
+// Строчная пара заглавной буквы. Буквы, у которых нет простой пары, и остальные символы не меняются
+char32_t FoldChar(char32_t code) noexcept {
+    if (code < 0x80) {
+        return code >= 'A' && code <= 'Z' ? code + 0x20 : code;
+    }
+    if (code < 0x100) {
+        return code >= 0xC0 && code <= 0xDE && code != 0xD7 ? code + 0x20 : code;
+    }
+    if (code < 0x180) {
+        // Latin Extended-A: заглавные и строчные буквы чередуются, но в 0x0139–0x0148 и 0x0179–0x017E
+        // заглавные стоят на нечётных местах. У 0x0130 простой пары нет, 0x0138 — строчная
+        if (code == 0x0178) {
+            return 0xFF;
+        }
+        if ((code >= 0x0139 && code <= 0x0148) || (code >= 0x0179 && code <= 0x017E)) {
+            return code % 2 == 1 ? code + 1 : code;
+        }
+        return code % 2 == 0 && code != 0x0130 && code != 0x0138 ? code + 1 : code;
+    }
+    if (code >= 0x0386 && code <= 0x03AB) {
+        if (code >= 0x0391) {
+            return code != 0x03A2 ? code + 0x20 : code;
+        }
+        if (code == 0x0386) {
+            return 0x03AC;
+        }
+        if (code >= 0x0388 && code <= 0x038A) {
+            return code + 0x25;
+        }
+        if (code == 0x038C) {
+            return 0x03CC;
+        }
+        // 0x0390 — строчная буква без заглавной пары
+        return code == 0x038E || code == 0x038F ? code + 0x3F : code;
+    }
+    if (code == 0x03C2) {
+        // Конечная сигма совпадает с обычной
+        return 0x03C3;
+    }
+    if (code >= 0x0400 && code <= 0x052F) {
+        if (code < 0x0410) {
+            return code + 0x50;
+        }
+        if (code < 0x0430) {
+            return code + 0x20;
+        }
+        if (code == 0x04C0) {
+            return 0x04CF;
+        }
+        if (code >= 0x04C1 && code <= 0x04CE) {
+            return code % 2 == 1 ? code + 1 : code;
+        }
+        if ((code >= 0x0460 && code <= 0x0481) || (code >= 0x048A && code <= 0x04BF) || code >= 0x04D0) {
+            return code % 2 == 0 ? code + 1 : code;
+        }
+    }
+    return code;
+}
+
+} // namespace
+
+Utf8Char DecodeUtf8Char(std::string_view text, size_t position) noexcept {
+    const auto byte = static_cast<unsigned char>(text[position]);
+    if (byte < 0x80) {
+        return { byte, 1 };
+    }
+    const auto [code, size] = DecodeChar(text, position);
+    return { code == INVALID_CODE_POINT ? INVALID_UTF8_BYTE + byte : code, size };
+}
+
+Tokenizer::Tokenizer(TokenizerOptions options)
+    : options_(options) {
+    for (size_t byte = 0; byte < ascii_separators_.size(); ++byte) {
+        const char c = static_cast<char>(byte);
+        ascii_separators_[byte] = IsAsciiSpace(c) || (options_.split_punctuation && IsAsciiPunctuation(c));
+    }
+}
+
+std::vector<std::string_view> Tokenizer::Tokenize(std::string_view text, WordStorage& storage) const {
+    std::vector<std::string_view> words;
+    size_t word_begin = text.npos;
+    bool needs_folding = false;
+    const auto finish_word = [&](size_t word_end) {
+        if (word_begin == text.npos) {
+            return;
+        }
+        const std::string_view word = text.substr(word_begin, word_end - word_begin);
+        words.push_back(needs_folding ? std::string_view{ storage.emplace_front(FoldCase(word)) } : word);
+        word_begin = text.npos;
+        needs_folding = false;
+    };
+
+    for (size_t position = 0; position < text.size();) {
+        const auto byte = static_cast<unsigned char>(text[position]);
+        if (byte < 0x80) {
+            if (ascii_separators_[byte]) {
+                finish_word(position);
+            }
+            else {
+                if (word_begin == text.npos) {
+                    word_begin = position;
+                }
+                needs_folding = needs_folding || (options_.fold_case && byte >= 'A' && byte <= 'Z');
+            }
+            ++position;
+            continue;
+        }
+        const auto [code, size] = DecodeChar(text, position);
+        if (IsSeparator(code)) {
+            finish_word(position);
+        }
+        else {
+            if (word_begin == text.npos) {
+                word_begin = position;
+            }
+            needs_folding = needs_folding || (options_.fold_case && FoldChar(code) != code);
+        }
+        position += size;
+    }
+    finish_word(text.size());
+    return words;
+}
+
+std::vector<std::string_view> Tokenizer::SplitOnWhitespace(std::string_view text) {
+    static const Tokenizer whitespace_tokenizer({ false, false });
+    // Без приведения регистра хранилище не заполняется
+    WordStorage unused;
+    return whitespace_tokenizer.Tokenize(text, unused);
+}
+
+bool Tokenizer::IsSeparator(char32_t code) const noexcept {
+    return code != INVALID_CODE_POINT && (IsUnicodeSpace(code) || (options_.split_punctuation && IsUnicodePunctuation(code)));
+}
+
+std::string Tokenizer::FoldCase(std::string_view word) const {
+    std::string folded;
+    folded.reserve(word.size());
+    for (size_t position = 0; position < word.size();) {
+        const auto byte = static_cast<unsigned char>(word[position]);
+        if (byte < 0x80) {
+            folded += static_cast<char>(FoldChar(byte));
+            ++position;
+            continue;
+        }
+        const auto [code, size] = DecodeChar(word, position);
+        if (code == INVALID_CODE_POINT) {
+            folded += word[position];
+        }
+        else {
+            AppendChar(folded, FoldChar(code));
+        }
+        position += size;
+    }
+    return folded;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <forward_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Настройки деления текста на слова. Документы, запросы и стоп-слова делятся одним и тем же
+// токенизатором, поэтому "Кот", "кот" и "кот," становятся одним словом индекса
+struct TokenizerOptions {
+    // Приводить буквы к нижнему регистру: ASCII, Latin-1, Latin Extended-A, греческий и кириллица
+    bool fold_case = true;
+    // Делить слова и по знакам препинания, а не только по пробельным символам
+    bool split_punctuation = true;
+};
+
+// Символ текста в UTF-8 и его длина в байтах
+struct Utf8Char {
+    char32_t code;
+    size_t size;
+};
+
+// Каждый байт некорректной последовательности UTF-8 — отдельный символ с кодом INVALID_UTF8_BYTE + байт,
+// за пределами Unicode, поэтому разные некорректные байты не совпадают
+constexpr char32_t INVALID_UTF8_BYTE = 0x110000;
+
+// Символ UTF-8, начинающийся с байта position
+Utf8Char DecodeUtf8Char(std::string_view text, size_t position) noexcept;
+
+// Слова, которые после приведения к нижнему регистру отличаются от исходного текста. Узлы списка
+// не переезжают, поэтому string_view на слова живут, пока живо хранилище, в том числе после перемещения
+using WordStorage = std::forward_list<std::string>;
+
+// Делит текст в UTF-8 на слова по пробельным символам Unicode и, если нужно, по знакам препинания
+// и приводит слова к нижнему регистру. Байты ASCII разбираются по таблице, без декодирования UTF-8.
+// Некорректные последовательности UTF-8 остаются частью слова как есть
+class Tokenizer {
+public:
+    explicit Tokenizer(TokenizerOptions options = {});
+
+    const TokenizerOptions& GetOptions() const noexcept {
+        return options_;
+    }
+
+    // Слова, которые не изменились, указывают в text, приведённые к нижнему регистру — в storage
+    std::vector<std::string_view> Tokenize(std::string_view text, WordStorage& storage) const;
+
+    // Делит только по пробельным символам и не меняет слов: так запрос делится на слова с операторами
+    static std::vector<std::string_view> SplitOnWhitespace(std::string_view text);
+
+private:
+    bool IsSeparator(char32_t code) const noexcept;
+
+    std::string FoldCase(std::string_view word) const;
+
+    TokenizerOptions options_;
+    std::array<bool, 128> ascii_separators_{};
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <algorithm>
+#include <string_view>
+#include <utility>
+
+// Невладеющий взгляд на частоты слов документа: непрерывный массив пар (слово, частота),
+// упорядоченный по слову. Действителен, пока документ не удалён из сервера
+class WordFrequenciesView {
+public:
+    using value_type = std::pair<std::string_view, double>;
+    using const_iterator = const value_type*;
+    using iterator = const_iterator;
+
+    WordFrequenciesView() = default;
+
+    WordFrequenciesView(const value_type* data, size_t size) noexcept
+        : data_(data)
+        , size_(size) {
+    }
+
+    const_iterator begin() const noexcept {
+        return data_;
+    }
+
+    const_iterator end() const noexcept {
+        return data_ + size_;
+    }
+
+    size_t size() const noexcept {
+        return size_;
+    }
+
+    bool empty() const noexcept {
+        return size_ == 0;
+    }
+
+    const value_type& operator[](size_t index) const noexcept {
+        return data_[index];
+    }
+
+    const_iterator find(std::string_view word) const noexcept {
+        const auto it = std::lower_bound(begin(), end(), word, [](const value_type& entry, std::string_view value) {
+            return entry.first < value;
+            });
+        return it != end() && it->first == word ? it : end();
+    }
+
+    size_t count(std::string_view word) const noexcept {
+        return find(word) != end() ? 1 : 0;
+    }
+
+private:
+    const value_type* data_ = nullptr;
+    size_t size_ = 0;
+};